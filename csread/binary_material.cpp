@@ -0,0 +1,199 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "binary_material.h"
+#include "table_cache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CSREAD_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char binary_material_format::magic[8];
+const uint32_t binary_material_format::version;
+const uint32_t binary_material_format::alignment;
+const uint32_t binary_material_format::byte_order;
+
+namespace
+{
+	using format = binary_material_format;
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + format::alignment - 1) / format::alignment * format::alignment;
+	}
+
+	bool is_little_endian()
+	{
+		const uint32_t one = 1;
+		unsigned char first_byte;
+		std::memcpy(&first_byte, &one, 1);
+		return first_byte == 1;
+	}
+}
+
+void binary_material_writer::add_section(section_t section, void const * data, size_t size)
+{
+	char const * bytes = static_cast<char const *>(data);
+	section.size = size;
+	section.offset = 0; // Determined when writing
+	sections.push_back(section);
+	section_data.emplace_back(bytes, bytes + size);
+}
+
+void binary_material_writer::write(std::string const & filename) const
+{
+	if (!is_little_endian())
+		throw std::runtime_error("Writing binary material files is only supported on little-endian machines.");
+
+	// Determine the layout
+	std::vector<section_t> layout(sections);
+	uint64_t offset = sizeof(format::header_t) + layout.size() * sizeof(section_t);
+	for (section_t& section : layout)
+	{
+		offset = align(offset);
+		section.offset = offset;
+		offset += section.size;
+	}
+	const uint64_t file_size = offset;
+
+	// Assemble everything after the header in memory, for the checksum.
+	std::vector<char> body(file_size - sizeof(format::header_t), 0);
+	std::memcpy(body.data(), layout.data(), layout.size() * sizeof(section_t));
+	for (size_t i = 0; i < layout.size(); ++i)
+	{
+		std::memcpy(body.data() + layout[i].offset - sizeof(format::header_t),
+			section_data[i].data(), section_data[i].size());
+	}
+
+	format::header_t header;
+	std::memcpy(header.magic, format::magic, sizeof(header.magic));
+	header.version = format::version;
+	header.byte_order = format::byte_order;
+	header.file_size = file_size;
+	header.checksum = table_cache::hash_bytes(body.data(), body.size());
+	header.section_count = layout.size();
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	file.write(body.data(), body.size());
+	if (!file)
+		throw std::runtime_error("Error writing binary material file " + filename);
+}
+
+binary_material_file::binary_material_file(std::string const & filename, bool verify_checksum)
+{
+	if (!is_little_endian())
+		throw std::runtime_error("Reading binary material files is only supported on little-endian machines.");
+
+#ifdef CSREAD_HAVE_MMAP
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Could not open binary material file " + filename);
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("Could not stat binary material file " + filename);
+	}
+	_size = static_cast<size_t>(file_stat.st_size);
+	if (_size < sizeof(format::header_t))
+	{
+		close(fd);
+		throw std::runtime_error("Binary material file " + filename + " is too small.");
+	}
+	// Private mapping: writes by the user, if any, do not end up in the file.
+	void* map = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		throw std::runtime_error("Could not map binary material file " + filename);
+	_data = static_cast<char*>(map);
+	_mapped = true;
+#else
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		throw std::runtime_error("Could not open binary material file " + filename);
+	_size = static_cast<size_t>(file.tellg());
+	if (_size < sizeof(format::header_t))
+		throw std::runtime_error("Binary material file " + filename + " is too small.");
+	_data = new char[_size];
+	file.seekg(0);
+	file.read(_data, _size);
+	if (!file)
+	{
+		delete[] _data;
+		throw std::runtime_error("Error reading binary material file " + filename);
+	}
+#endif
+
+	try
+	{
+		format::header_t header;
+		std::memcpy(&header, _data, sizeof(header));
+		if (std::memcmp(header.magic, format::magic, sizeof(header.magic)) != 0)
+			throw std::runtime_error(filename + " is not a binary material file.");
+		if (header.version != format::version)
+			throw std::runtime_error("Binary material file " + filename + " has unsupported version.");
+		if (header.byte_order != format::byte_order)
+			throw std::runtime_error("Binary material file " + filename + " has wrong byte order.");
+		if (header.file_size != _size
+			|| header.section_count > (_size - sizeof(header)) / sizeof(section_t))
+		{
+			throw std::runtime_error("Binary material file " + filename + " is truncated.");
+		}
+		if (verify_checksum && table_cache::hash_bytes(_data + sizeof(header), _size - sizeof(header)) != header.checksum)
+			throw std::runtime_error("Binary material file " + filename + " has wrong checksum.");
+
+		_sections.resize(header.section_count);
+		std::memcpy(_sections.data(), _data + sizeof(header), _sections.size() * sizeof(section_t));
+		for (section_t const & section : _sections)
+		{
+			if (section.offset > _size || section.size > _size - section.offset)
+				throw std::runtime_error("Binary material file " + filename + " is corrupt.");
+		}
+	}
+	catch (...)
+	{
+#ifdef CSREAD_HAVE_MMAP
+		munmap(_data, _size);
+#else
+		delete[] _data;
+#endif
+		throw;
+	}
+}
+
+binary_material_file::~binary_material_file()
+{
+#ifdef CSREAD_HAVE_MMAP
+	if (_mapped)
+	{
+		munmap(_data, _size);
+		return;
+	}
+#endif
+	delete[] _data;
+}
+
+auto binary_material_file::get_sections() const -> std::vector<section_t> const &
+{
+	return _sections;
+}
+
+auto binary_material_file::find_section(uint32_t type, uint32_t id) const -> section_t const *
+{
+	for (section_t const & section : _sections)
+	{
+		if (section.type == type && section.id == id)
+			return &section;
+	}
+	return nullptr;
+}
+
+void* binary_material_file::get_data(section_t const & section) const
+{
+	return _data + section.offset;
+}
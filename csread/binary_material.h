@@ -0,0 +1,124 @@
+#ifndef __BINARY_MATERIAL_H_
+#define __BINARY_MATERIAL_H_
+
+/*
+ * csread's own binary file format for materials.
+ *
+ * HDF5 files are relatively slow to open and parse. Files in this format are
+ * memory mapped instead of read: all tables are stored in the layout that is
+ * used in memory, so tables can refer to the mapped file directly.
+ *
+ * Layout, little-endian:
+ *   header_t
+ *   section_t[header.section_count]
+ *   data for each section, aligned to 64 bytes
+ *
+ * The checksum in the header covers everything after the header.
+ *
+ * These files are written by material::save_binary() or the csread_h5_to_binary
+ * tool, and read by material::load_binary().
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared definitions of the file format
+struct binary_material_format
+{
+	static const uint32_t version = 1;
+	static const uint32_t alignment = 64;
+
+	enum section_type_t : uint32_t
+	{
+		SEC_NAME,         // Material name, char[]
+		SEC_PROPERTIES,   // property_t[]
+		SEC_INTERN_1D,    // Energy axis, then values; double[2*N[0]]
+		SEC_INTERN_2D,    // Energy axis, then values; double[N[0] + N[0]*N[1]]
+		SEC_OUTER_SHELLS, // double[N[0]]
+		SEC_FAST_TABLE    // Values of a fast table with value_size bytes each, N[0]*N[1] of them
+	};
+
+	struct header_t
+	{
+		char magic[8];          // "csrdbin" + '\0'
+		uint32_t version;
+		uint32_t byte_order;    // 0x01020304, written in native order
+		uint64_t file_size;
+		uint64_t checksum;      // FNV-1a of everything after the header
+		uint64_t section_count;
+	};
+
+	struct section_t
+	{
+		uint32_t type;       // section_type_t
+		uint32_t id;         // Which table, or which property; depends on the type
+		uint64_t offset;     // From the start of the file
+		uint64_t size;       // In bytes
+		uint64_t N[2];       // Table dimensions
+		double K_range[2];   // Energy range for fast tables
+		uint32_t value_size; // Size of the table values, in bytes
+		uint32_t reserved;
+	};
+
+	struct property_t
+	{
+		double value;
+		int32_t units[5]; // See dimension.h
+		int32_t reserved;
+	};
+
+	static constexpr char magic[8] = "csrdbin";
+	static const uint32_t byte_order = 0x01020304;
+};
+
+// Collects sections, and writes them to file.
+class binary_material_writer
+{
+public:
+	using section_t = binary_material_format::section_t;
+
+	// Add a section. The data is copied; the offset and size of the section are filled in.
+	void add_section(section_t section, void const * data, size_t size);
+
+	// May throw std::runtime_error exceptions.
+	void write(std::string const & filename) const;
+
+private:
+	std::vector<section_t> sections;
+	std::vector<std::vector<char>> section_data;
+};
+
+// A binary material file, memory mapped.
+// Pages are mapped copy-on-write: writing to the data does not affect the file.
+class binary_material_file
+{
+public:
+	using section_t = binary_material_format::section_t;
+
+	// Open and map a file, checking its header and section table.
+	// If verify_checksum is set, all data is read once to check the checksum.
+	// May throw std::runtime_error exceptions.
+	binary_material_file(std::string const & filename, bool verify_checksum = false);
+	~binary_material_file();
+
+	binary_material_file(binary_material_file const &) = delete;
+	binary_material_file& operator=(binary_material_file const &) = delete;
+
+	std::vector<section_t> const & get_sections() const;
+
+	// Find the first section of a given type and id. Returns nullptr if there is none.
+	section_t const * find_section(uint32_t type, uint32_t id) const;
+
+	// Pointer to a section's data in the mapped file.
+	void* get_data(section_t const & section) const;
+
+private:
+	char* _data = nullptr;
+	size_t _size = 0;
+	bool _mapped = false; // false: _data was allocated with new[]
+	std::vector<section_t> _sections;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "file_image.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CSREAD_HAVE_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool io_statistics::get_process_io(io_statistics & stats)
+{
+	std::ifstream file("/proc/self/io");
+	if (!file)
+		return false;
+
+	io_statistics result;
+	bool have_rchar = false, have_syscr = false;
+	std::string field;
+	uint64_t value;
+	while (file >> field >> value)
+	{
+		if (field == "rchar:")
+		{
+			result.bytes_read = value;
+			have_rchar = true;
+		}
+		else if (field == "syscr:")
+		{
+			result.syscalls = value;
+			have_syscr = true;
+		}
+	}
+	if (!have_rchar || !have_syscr)
+		return false;
+
+	stats = result;
+	return true;
+}
+
+#ifdef CSREAD_HAVE_MMAP
+
+file_image::file_image(std::string const & filename, strategy_t strategy, io_statistics & stats)
+{
+	const int fd = open(filename.c_str(), O_RDONLY);
+	++stats.syscalls;
+	if (fd < 0)
+		throw std::runtime_error("Could not open " + filename);
+
+	struct stat file_stat;
+	++stats.syscalls;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("Could not stat " + filename);
+	}
+	_size = static_cast<size_t>(file_stat.st_size);
+
+	if (strategy == MMAP)
+	{
+		void* map = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		++stats.syscalls;
+		close(fd);
+		++stats.syscalls;
+		if (map == MAP_FAILED)
+			throw std::runtime_error("Could not map " + filename);
+		_data = static_cast<char*>(map);
+		_mapped = true;
+		stats.bytes_read += _size;
+		return;
+	}
+
+	// One read for the whole file, unless the system returns less.
+	_data = new char[_size];
+	size_t offset = 0;
+	while (offset < _size)
+	{
+		const ssize_t count = read(fd, _data + offset, _size - offset);
+		++stats.syscalls;
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+		{
+			close(fd);
+			delete[] _data;
+			throw std::runtime_error("Error reading " + filename);
+		}
+		offset += static_cast<size_t>(count);
+		stats.bytes_read += static_cast<uint64_t>(count);
+	}
+	close(fd);
+	++stats.syscalls;
+}
+
+file_image::~file_image()
+{
+	if (_mapped)
+	{
+		munmap(_data, _size);
+		return;
+	}
+	delete[] _data;
+}
+
+#else // CSREAD_HAVE_MMAP
+
+// No mmap: always read, and count one system call per stream operation.
+file_image::file_image(std::string const & filename, strategy_t, io_statistics & stats)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	++stats.syscalls;
+	if (!file)
+		throw std::runtime_error("Could not open " + filename);
+	_size = static_cast<size_t>(file.tellg());
+	_data = new char[_size];
+	file.seekg(0);
+	file.read(_data, _size);
+	++stats.syscalls;
+	if (!file)
+	{
+		delete[] _data;
+		throw std::runtime_error("Error reading " + filename);
+	}
+	stats.bytes_read += _size;
+}
+
+file_image::~file_image()
+{
+	delete[] _data;
+}
+
+#endif // CSREAD_HAVE_MMAP
+
+void* file_image::data() const
+{
+	return _data;
+}
+
+size_t file_image::size() const
+{
+	return _size;
+}
@@ -0,0 +1,54 @@
+#ifndef __FILE_IMAGE_H_
+#define __FILE_IMAGE_H_
+
+/*
+ * Complete contents of a file in memory, so that HDF5 can be served from
+ * memory instead of issuing many small reads to the file system.
+ *
+ * The file is either read with as few large read() calls as possible, or
+ * memory mapped. The I/O this takes is recorded in an io_statistics struct.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// I/O done while loading a material.
+struct io_statistics
+{
+	uint64_t bytes_read = 0;
+	uint64_t syscalls = 0; // File-related system calls: open, read, mmap, ...
+
+	// Counters of the whole process from /proc/self/io (rchar and syscr).
+	// Returns false, leaving the argument untouched, if not available.
+	static bool get_process_io(io_statistics & stats);
+};
+
+class file_image
+{
+public:
+	enum strategy_t
+	{
+		READ, // Read the whole file into a buffer
+		MMAP  // Memory map the file; the bytes are read when first accessed
+	};
+
+	// May throw std::runtime_error exceptions.
+	// I/O is added to the statistics. For MMAP, the whole file is counted as
+	// read, page faults are not counted as system calls.
+	file_image(std::string const & filename, strategy_t strategy, io_statistics & stats);
+	~file_image();
+
+	file_image(file_image const &) = delete;
+	file_image& operator=(file_image const &) = delete;
+
+	void* data() const;
+	size_t size() const;
+
+private:
+	char* _data = nullptr;
+	size_t _size = 0;
+	bool _mapped = false;
+};
+
+#endif
@@ -3,30 +3,107 @@
 
 /*
  * 2D table specifically intended for inverse cumulative distribution functions in the simulation loop.
+ *
+ * The second template parameter selects how the values are stored, see
+ * table/table_encoding.h. Tables are built with the native encoding, compact
+ * tables are encoded from those. Each energy is a row for the encoding.
+ * Tables with table_encoding::slope interpolate faster at twice the memory.
+ *
+ * The third template parameter is the energy axis: ax_logspace, or
+ * ax_piecewise_logspace for more points where they are needed, with the math
+ * policy for its log() (table/math_policy.h).
  */
 
+#include <type_traits>
+#include <utility>
 #include "table/array2D_ax.h"
 #include "table/ax_logspace.h"
-#include "table/ax_linspace.h"
+#include "table/ax_piecewise_logspace.h"
+#include "table/math_policy.h"
+#include "table/ax_unit_interval.h"
+#include "table/encoded_array2D.h"
+#include "table/slope_array2D.h"
+#include "table/table_encoding.h"
+#include "simd/batch.h"
 
-template<typename real_type>
+// Compact encodings, and table_encoding::slope
+template<typename real_type, typename encoding = table_encoding::native,
+	typename energy_axis = ax_logspace<real_type>>
 class icdf_table :
-	private array2D_ax<real_type, ax_logspace<real_type>, ax_linspace<real_type>>
+	private encoded_array2D<real_type, encoding, energy_axis, ax_unit_interval<real_type>>
 {
 public:
 	using value_type = real_type;
-	using energy_axis_type = ax_logspace<real_type>;
-	using probability_axis_type = ax_linspace<real_type>;
+	using energy_axis_type = energy_axis;
+	using probability_axis_type = ax_unit_interval<real_type>;
+	using base_type = encoded_array2D<value_type, encoding, energy_axis_type, probability_axis_type>;
+	using native_type = icdf_table<real_type, table_encoding::native, energy_axis>;
+
+	// Encode a native table.
+	icdf_table(native_type const & table) :
+		base_type(static_cast<typename native_type::base_type const &>(table))
+	{}
+
+	value_type get(value_type K, value_type P) const
+	{
+		return base_type::at_linear(K, P);
+	}
+	// out[i] = get(K[i], P[i]) for n samples
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i], P[i]);
+	}
+
+	using base_type::operator();
+	using base_type::get_x;
+	using base_type::get_y;
+	using base_type::get_encoding_error;
+
+	icdf_table(icdf_table &&) = default;
+	icdf_table& operator=(icdf_table &&) = default;
+
+private:
+	// Not copyable, like the native table
+	icdf_table(icdf_table const &) = delete;
+	icdf_table& operator=(icdf_table const &) = delete;
+};
+
+// Native encoding: values stored as real_type
+template<typename real_type, typename energy_axis>
+class icdf_table<real_type, table_encoding::native, energy_axis> :
+	private array2D_ax<real_type, energy_axis, ax_unit_interval<real_type>>
+{
+public:
+	using value_type = real_type;
+	using energy_axis_type = energy_axis;
+	using probability_axis_type = ax_unit_interval<real_type>;
 	using base_type = array2D_ax<value_type, energy_axis_type, probability_axis_type>;
 
 	icdf_table(base_type const & icdf_table) :
 		base_type(icdf_table)
 	{}
+	// Takes over the data, which is not copied.
+	icdf_table(base_type && icdf_table) :
+		base_type(std::move(icdf_table))
+	{}
+	// The same table with another math policy. Takes over the data.
+	template<typename other_axis>
+	explicit icdf_table(icdf_table<real_type, table_encoding::native, other_axis> && table) :
+		base_type(std::move(static_cast<typename icdf_table<real_type, table_encoding::native, other_axis>::base_type &>(table)))
+	{}
 
 	value_type get(value_type K, value_type P) const
 	{
 		return base_type::at_linear(K, P);
 	}
+	// out[i] = get(K[i], P[i]) for n samples. Vectorized for float tables on
+	// ax_logspace with exact_math, see simd/batch.h for the difference from get().
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n) const
+	{
+		get_batch(K, P, out, n, std::integral_constant<bool,
+			std::is_same<value_type, float>::value && std::is_same<energy_axis_type, ax_logspace<float, exact_math>>::value>());
+	}
 
 	using base_type::operator();
 	using base_type::get_x;
@@ -41,6 +118,23 @@ private:
 	// (if you're here because of a compiler error: pass by (const) reference)
 	icdf_table(icdf_table const &) = delete;
 	icdf_table& operator=(icdf_table const &) = delete;
+
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n, std::true_type /*vectorized*/) const
+	{
+		const energy_axis_type& K_axis = base_type::get_x_axis();
+		const probability_axis_type& P_axis = base_type::get_y_axis();
+		simd_batch_bilinear(base_type::data(), base_type::width(), base_type::height(),
+			K_axis.log_low(), K_axis.log_inv_step(), P_axis.low(), P_axis.inv_step(), K, P, out, n);
+	}
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n, std::false_type /*vectorized*/) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i], P[i]);
+	}
+
+	// Compact tables are encoded from this one
+	template<typename, typename, typename>
+	friend class icdf_table;
 };
 
 #endif
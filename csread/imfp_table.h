@@ -4,29 +4,109 @@
 /*
  * 1D table specifically intended for inverse mean free paths in the simulation loop.
  * The IMFP values are stored in log space and therefore get log interpolation.
+ *
+ * The second template parameter selects how the values are stored, see
+ * table/table_encoding.h. Tables are built with the native encoding, compact
+ * tables are encoded from those. So are tables with table_encoding::slope,
+ * which interpolate faster at twice the memory.
+ *
+ * The third template parameter is the energy axis: ax_logspace, or
+ * ax_piecewise_logspace for more points where they are needed. The math
+ * policy of the axis (table/math_policy.h) also applies to get().
  */
 
 #include <limits>
 #include <cmath>
+#include <type_traits>
+#include <utility>
 #include "table/array1D_ax.h"
 #include "table/ax_logspace.h"
+#include "table/ax_piecewise_logspace.h"
+#include "table/encoded_array1D.h"
+#include "table/math_policy.h"
+#include "table/slope_array1D.h"
+#include "table/table_encoding.h"
+#include "simd/batch.h"
 
-template<typename real_type>
+// Compact encodings, and table_encoding::slope
+template<typename real_type, typename encoding = table_encoding::native,
+	typename energy_axis = ax_logspace<real_type>>
 class imfp_table :
-	private array1D_ax<real_type, ax_logspace<real_type>>
+	private encoded_array1D<real_type, encoding, energy_axis>
 {
 public:
 	using value_type = real_type;
-	using axis_type = ax_logspace<real_type>;
+	using axis_type = energy_axis;
+	using math_policy = typename axis_type::math_policy;
+	using base_type = encoded_array1D<value_type, encoding, axis_type>;
+	using native_type = imfp_table<real_type, table_encoding::native, energy_axis>;
+
+	// Encode a native table.
+	imfp_table(native_type const & table) :
+		base_type(static_cast<typename native_type::base_type const &>(table))
+	{}
+
+	value_type get(value_type K) const
+	{
+		return math_policy::exp(base_type::at_linear(K));
+	}
+	// out[i] = get(K[i]) for n energies
+	void get_batch(value_type const * K, value_type* out, size_t n) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i]);
+	}
+
+	// Note: base_type::operator() gets the LOG imfp.
+	using base_type::operator();
+	using base_type::get_x;
+
+	// Largest error in the stored log(imfp), which is about the relative error in the imfp.
+	using base_type::get_encoding_error;
+
+	imfp_table(imfp_table &&) = default;
+	imfp_table& operator=(imfp_table &&) = default;
+
+private:
+	// Not copyable, like the native table
+	imfp_table(imfp_table const &) = delete;
+	imfp_table& operator=(imfp_table const &) = delete;
+};
+
+// Native encoding: values stored as real_type
+template<typename real_type, typename energy_axis>
+class imfp_table<real_type, table_encoding::native, energy_axis> :
+	private array1D_ax<real_type, energy_axis>
+{
+public:
+	using value_type = real_type;
+	using axis_type = energy_axis;
+	using math_policy = typename axis_type::math_policy;
 	using base_type = array1D_ax<value_type, axis_type>;
 
 	imfp_table(base_type const & log_imfp_table) :
 		base_type(log_imfp_table)
 	{}
+	// Takes over the data, which is not copied.
+	imfp_table(base_type && log_imfp_table) :
+		base_type(std::move(log_imfp_table))
+	{}
+	// The same table with another math policy. Takes over the data.
+	template<typename other_axis>
+	explicit imfp_table(imfp_table<real_type, table_encoding::native, other_axis> && table) :
+		base_type(std::move(static_cast<typename imfp_table<real_type, table_encoding::native, other_axis>::base_type &>(table)))
+	{}
 
 	value_type get(value_type K) const
 	{
-		return std::exp(base_type::at_linear(K));
+		return math_policy::exp(base_type::at_linear(K));
+	}
+	// out[i] = get(K[i]) for n energies. Vectorized for float tables on
+	// ax_logspace with exact_math, see simd/batch.h for the difference from get().
+	void get_batch(value_type const * K, value_type* out, size_t n) const
+	{
+		get_batch(K, out, n, std::integral_constant<bool,
+			std::is_same<value_type, float>::value && std::is_same<axis_type, ax_logspace<float, exact_math>>::value>());
 	}
 
 	// Note: base_type::operator() gets the LOG imfp.
@@ -42,6 +122,22 @@ private:
 	// (if you're here because of a compiler error: pass by (const) reference)
 	imfp_table(imfp_table const &) = delete;
 	imfp_table& operator=(imfp_table const &) = delete;
+
+	void get_batch(value_type const * K, value_type* out, size_t n, std::true_type /*vectorized*/) const
+	{
+		const axis_type& K_axis = base_type::get_x_axis();
+		simd_batch_exp_linear(base_type::data(), base_type::size(),
+			K_axis.log_low(), K_axis.log_inv_step(), K, out, n);
+	}
+	void get_batch(value_type const * K, value_type* out, size_t n, std::false_type /*vectorized*/) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i]);
+	}
+
+	// Compact tables are encoded from this one
+	template<typename, typename, typename>
+	friend class imfp_table;
 };
 
 #endif
@@ -5,30 +5,106 @@
  * 2D table specifically intended for ionisation cross sections in the simulation loop.
  * This table does not bilinearly interpolate when a value is requested, rounding down
  * in both energy and P instead. This guarantees that physical binding energies are found.
+ *
+ * The second template parameter selects how the values are stored, see
+ * table/table_encoding.h. Tables are built with the native encoding, compact
+ * tables are encoded from those. Each energy is a row for the encoding.
+ *
+ * The third template parameter is the energy axis: ax_logspace, or
+ * ax_piecewise_logspace for more points where they are needed, with the math
+ * policy for its log() (table/math_policy.h).
  */
 
+#include <type_traits>
+#include <utility>
 #include "table/array2D_ax.h"
 #include "table/ax_logspace.h"
-#include "table/ax_linspace.h"
+#include "table/ax_piecewise_logspace.h"
+#include "table/math_policy.h"
+#include "table/ax_unit_interval.h"
+#include "table/encoded_array2D.h"
+#include "table/table_encoding.h"
+#include "table/table_index.h"
+#include "simd/batch.h"
 
-template<typename real_type>
+// Compact encodings
+template<typename real_type, typename encoding = table_encoding::native,
+	typename energy_axis = ax_logspace<real_type>>
 class ionization_table :
-	private array2D_ax<real_type, ax_logspace<real_type>, ax_linspace<real_type>>
+	private encoded_array2D<real_type, encoding, energy_axis, ax_unit_interval<real_type>>
 {
 public:
 	using value_type = real_type;
-	using energy_axis_type = ax_logspace<real_type>;
-	using probability_axis_type = ax_linspace<real_type>;
+	using energy_axis_type = energy_axis;
+	using probability_axis_type = ax_unit_interval<real_type>;
+	using base_type = encoded_array2D<value_type, encoding, energy_axis_type, probability_axis_type>;
+	using native_type = ionization_table<real_type, table_encoding::native, energy_axis>;
+
+	// Encode a native table.
+	ionization_table(native_type const & table) :
+		base_type(static_cast<typename native_type::base_type const &>(table))
+	{}
+
+	// Same as for the native table
+	value_type get(value_type K, value_type P) const
+	{
+		const real_type true_x = base_type::find_x(K);
+		const real_type true_y = base_type::find_y(P);
+
+		if (true_x < 0 || true_y < 0)
+			return -1;
+
+		return (*this)(rounddown_index(true_x, base_type::width()), rounddown_index(true_y, base_type::height()));
+	}
+	// out[i] = get(K[i], P[i]) for n samples
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i], P[i]);
+	}
+
+	using base_type::operator();
+	using base_type::get_x;
+	using base_type::get_y;
+	using base_type::get_encoding_error;
+
+	ionization_table(ionization_table &&) = default;
+	ionization_table& operator=(ionization_table &&) = default;
+
+private:
+	// Not copyable, like the native table
+	ionization_table(ionization_table const &) = delete;
+	ionization_table& operator=(ionization_table const &) = delete;
+};
+
+// Native encoding: values stored as real_type
+template<typename real_type, typename energy_axis>
+class ionization_table<real_type, table_encoding::native, energy_axis> :
+	private array2D_ax<real_type, energy_axis, ax_unit_interval<real_type>>
+{
+public:
+	using value_type = real_type;
+	using energy_axis_type = energy_axis;
+	using probability_axis_type = ax_unit_interval<real_type>;
 	using base_type = array2D_ax<value_type, energy_axis_type, probability_axis_type>;
 
 	ionization_table(base_type const & ionization_table) :
 		base_type(ionization_table)
 	{}
+	// Takes over the data, which is not copied.
+	ionization_table(base_type && ionization_table) :
+		base_type(std::move(ionization_table))
+	{}
+	// The same table with another math policy. Takes over the data.
+	template<typename other_axis>
+	explicit ionization_table(ionization_table<real_type, table_encoding::native, other_axis> && table) :
+		base_type(std::move(static_cast<typename ionization_table<real_type, table_encoding::native, other_axis>::base_type &>(table)))
+	{}
 
 	value_type get(value_type K, value_type P) const
 	{
-		const real_type true_x = base_type::_x_axis.find(K);
-		const real_type true_y = base_type::_y_axis.find(P);
+		const real_type true_x = base_type::find_x(K);
+		const real_type true_y = base_type::find_y(P);
 
 		// We DO NOT want to extrapolate on this end. Simply return "-1" binding energy.
 		if (true_x < 0 || true_y < 0)
@@ -36,9 +112,14 @@ public:
 
 		// No interpolation: these are binding energies. K should be rounded down for obvious reasons.
 		// P is also rounded down, consistent with e-scatter.
-		const size_t K_index = std::min(static_cast<size_t>(true_x), base_type::width() - 1);
-		const size_t P_index = std::min(static_cast<size_t>(true_y), base_type::height() - 1);
-		return (*this)(K_index, P_index);
+		return (*this)(rounddown_index(true_x, base_type::width()), rounddown_index(true_y, base_type::height()));
+	}
+	// out[i] = get(K[i], P[i]) for n samples. Vectorized for float tables on
+	// ax_logspace with exact_math, see simd/batch.h for the difference from get().
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n) const
+	{
+		get_batch(K, P, out, n, std::integral_constant<bool,
+			std::is_same<value_type, float>::value && std::is_same<energy_axis_type, ax_logspace<float, exact_math>>::value>());
 	}
 
 	using base_type::operator();
@@ -54,6 +135,23 @@ private:
 	// (if you're here because of a compiler error: pass by (const) reference)
 	ionization_table(ionization_table const &) = delete;
 	ionization_table& operator=(ionization_table const &) = delete;
+
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n, std::true_type /*vectorized*/) const
+	{
+		const energy_axis_type& K_axis = base_type::get_x_axis();
+		const probability_axis_type& P_axis = base_type::get_y_axis();
+		simd_batch_rounddown(base_type::data(), base_type::width(), base_type::height(),
+			K_axis.log_low(), K_axis.log_inv_step(), P_axis.low(), P_axis.inv_step(), K, P, out, n);
+	}
+	void get_batch(value_type const * K, value_type const * P, value_type* out, size_t n, std::false_type /*vectorized*/) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = get(K[i], P[i]);
+	}
+
+	// Compact tables are encoded from this one
+	template<typename, typename, typename>
+	friend class ionization_table;
 };
 
 #endif
@@ -1,15 +1,80 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <H5Cpp.h>
+#include <H5LTpublic.h>
 #include "material.h"
+#include "binary_material.h"
+#include "file_image.h"
+#include "shared_table_store.h"
+#include "table_cache.h"
 #include "units/unit_parser.h"
 #include "clamp.h"
+#include "table/linear_rows.h"
 
 /*
  * Helper functions for reading HDF5 data
  */
 
+// Lock that serializes all HDF5 calls, so that materials may be loaded from several threads.
+// Even thread-safe builds of the HDF5 library only make the C API thread-safe,
+// not the C++ wrappers used here, so we always take the lock.
+std::unique_lock<std::mutex> h5_lock()
+{
+	static std::mutex h5_mutex;
+	return std::unique_lock<std::mutex>(h5_mutex);
+}
+
+// Open an HDF5 file image in memory, through the core driver.
+// If copy is set, HDF5 keeps its own copy of the image. Otherwise, the buffer
+// is used directly and must outlive the file.
+std::unique_ptr<H5::H5File> h5_open_image(void* buffer, size_t size, bool copy)
+{
+	const unsigned int flags = copy ? 0 : (H5LT_FILE_IMAGE_DONT_COPY | H5LT_FILE_IMAGE_DONT_RELEASE);
+	const hid_t id = H5LTopen_file_image(buffer, size, flags);
+	if (id < 0)
+		throw std::runtime_error("Could not open HDF5 file image.");
+	std::unique_ptr<H5::H5File> file(new H5::H5File(id));
+	// H5File takes its own reference
+	H5Idec_ref(id);
+	return file;
+}
+
+// Adds the I/O done by the process during its lifetime to the statistics.
+// Used when HDF5 reads files itself, so that we cannot count its reads.
+class process_io_counter
+{
+public:
+	process_io_counter(io_statistics & stats, bool enabled) :
+		stats(stats), enabled(enabled && io_statistics::get_process_io(before))
+	{}
+
+	~process_io_counter()
+	{
+		io_statistics after;
+		if (enabled && io_statistics::get_process_io(after))
+		{
+			stats.bytes_read += after.bytes_read - before.bytes_read;
+			stats.syscalls += after.syscalls - before.syscalls;
+		}
+	}
+
+private:
+	io_statistics & stats;
+	io_statistics before;
+	bool enabled;
+};
+
 // Read an attribute
 std::string h5_read_attribute(H5::H5Object const & object, std::string const & attribute_name)
 {
@@ -40,73 +105,163 @@ std::pair<hsize_t, hsize_t> h5_get_2D_size(H5::DataSpace const & dataspace)
 	return{ dim[0], dim[1] };
 }
 
-// Load 1D table to std::vector of doubles
-std::vector<double> h5_read_1D_table(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions)
+// Open a dataset and check that its units have the expected dimensionality.
+// Returns the dataset and the value of its unit in internal units.
+std::pair<H5::DataSet, double> h5_open_table(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions)
 {
-	unit_parser _unit_parser;
-	_unit_parser.add_default_units();
-
 	H5::DataSet dataset = group.openDataSet(dataset_name);
-	H5::DataSpace dataspace = dataset.getSpace();
 
 	// Load units, check dimensionality
 	const std::string unit_string = h5_read_attribute(dataset, "units");
-	const quantity<double> unit_value = _unit_parser.parse_unit(unit_string);
+	const quantity<double> unit_value = unit_parser::parse_default_unit(unit_string);
 	if (unit_value.units != expected_dimensions)
 	{
 		throw std::runtime_error("Unexpected dimensionality " + unit_string
 			+ " for dataset " + dataset_name);
 	}
 
-	// Load data
-	hsize_t dim = h5_get_1D_size(dataspace);
-	std::vector<double> table(dim);
-	dataset.read(table.data(), H5::PredType::NATIVE_DOUBLE);
+	return{ dataset, unit_value.value };
+}
 
-	// Multiply by correct unit value
-	for (double& d : table)
-		d *= unit_value.value;
+// HDF5 memory type for reading into a buffer of real_type
+inline H5::PredType const & h5_native_type(double*)
+{
+	return H5::PredType::NATIVE_DOUBLE;
+}
+inline H5::PredType const & h5_native_type(float*)
+{
+	return H5::PredType::NATIVE_FLOAT;
+}
 
-	return table;
+// Read a dataset into a buffer of doubles or floats, multiplying by the unit value.
+// The multiplication is done by HDF5 while reading, so the data is only touched once.
+// By default, the full dataset is read; a selection may be given in file_space.
+template<typename real_type>
+void h5_read_table_data(H5::DataSet const & dataset, double unit_value, real_type* destination,
+	H5::DataSpace const & memory_space = H5::DataSpace::ALL,
+	H5::DataSpace const & file_space = H5::DataSpace::ALL)
+{
+	H5::DSetMemXferPropList transfer;
+	if (unit_value != 1)
+	{
+		char expression[32];
+		std::snprintf(expression, sizeof(expression), "x*%.17g", unit_value);
+		transfer.setDataTransform(expression);
+	}
+	dataset.read(destination, h5_native_type(destination), memory_space, file_space, transfer);
 }
 
-// Load 2D data to std::vector of doubles, indexed as [x*height + y]
-// Returns tuple(width, height, data)
-std::tuple<size_t, size_t, std::vector<double>> h5_read_2D_table(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions)
+// Table data read from file, ready to be adopted by array1D_ax or array2D_ax.
+// 2D data is indexed as [x*height + y]; for 1D data, height == 1.
+template<typename real_type>
+struct h5_table_data
 {
-	unit_parser _unit_parser;
-	_unit_parser.add_default_units();
+	size_t width;
+	size_t height;
+	std::unique_ptr<real_type[]> data;
+};
 
-	H5::DataSet dataset = group.openDataSet(dataset_name);
-	H5::DataSpace dataspace = dataset.getSpace();
+// Selection of rows (first dimension) of a table, typically the part of the
+// energy axis that is needed.
+struct h5_rows
+{
+	hsize_t total;  // Expected number of rows in the file
+	hsize_t offset; // First row to read
+	hsize_t count;  // Number of rows to read
+};
 
-	const std::string unit_string = h5_read_attribute(dataset, "units");
-	const quantity<double> unit_value = _unit_parser.parse_unit(unit_string);
-	if (unit_value.units != expected_dimensions)
+// Find the rows of an energy axis needed to cover the energy window, with one
+// extra point on either side so that interpolation near the edges is unchanged.
+h5_rows h5_find_rows(std::vector<double> const & energy, std::pair<double, double> window)
+{
+	const hsize_t total = energy.size();
+	if (total < 2)
+		throw std::runtime_error("Energy table has fewer than two elements.");
+
+	hsize_t first = std::lower_bound(energy.begin(), energy.end(), window.first) - energy.begin();
+	hsize_t last = std::upper_bound(energy.begin(), energy.end(), window.second) - energy.begin();
+	first = (first > 0 ? first - 1 : 0);
+	last = std::min(last + 1, total);
+
+	// Always keep at least two points to interpolate between
+	if (last < first + 2)
 	{
-		throw std::runtime_error("Unexpected dimensionality " + unit_string
-			+ " for dataset " + dataset_name);
+		first = std::min(first, total - 2);
+		last = first + 2;
 	}
 
-	// Load data
-	std::pair<hsize_t, hsize_t> dim = h5_get_2D_size(dataspace);
-	std::vector<double> table(dim.first * dim.second);
-	dataset.read(table.data(), H5::PredType::NATIVE_DOUBLE);
+	return{ total, first, last - first };
+}
+
+// Load 1D table to std::vector of doubles
+std::vector<double> h5_read_1D_table(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions)
+{
+	const std::pair<H5::DataSet, double> table = h5_open_table(group, dataset_name, expected_dimensions);
+
+	std::vector<double> data(h5_get_1D_size(table.first.getSpace()));
+	h5_read_table_data(table.first, table.second, data.data());
+	return data;
+}
+
+// Load the selected rows of a 1D table into a new[] buffer
+template<typename real_type>
+h5_table_data<real_type> h5_read_1D_data(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions, h5_rows const & rows)
+{
+	const std::pair<H5::DataSet, double> table = h5_open_table(group, dataset_name, expected_dimensions);
+
+	H5::DataSpace file_space = table.first.getSpace();
+	if (h5_get_1D_size(file_space) != rows.total)
+		throw std::runtime_error("Table " + dataset_name + " has different size than energy table.");
+
+	const hsize_t offset[1] = { rows.offset };
+	const hsize_t count[1] = { rows.count };
+	file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+	const H5::DataSpace memory_space(1, count);
 
-	// Multiply by correct unit value
-	for (double& d : table)
-		d *= unit_value.value;
+	h5_table_data<real_type> result{ rows.count, 1, std::unique_ptr<real_type[]>(new real_type[rows.count]) };
+	h5_read_table_data(table.first, table.second, result.data.get(), memory_space, file_space);
+	return result;
+}
+
+// Load the selected rows of a 2D table into a new[] buffer
+template<typename real_type>
+h5_table_data<real_type> h5_read_2D_data(H5::Group const & group, std::string const & dataset_name, dimension expected_dimensions, h5_rows const & rows)
+{
+	const std::pair<H5::DataSet, double> table = h5_open_table(group, dataset_name, expected_dimensions);
+
+	H5::DataSpace file_space = table.first.getSpace();
+	const std::pair<hsize_t, hsize_t> dim = h5_get_2D_size(file_space);
+	if (dim.first != rows.total)
+		throw std::runtime_error("Table " + dataset_name + " has different size than energy table.");
 
-	return std::tuple<size_t, size_t, std::vector<double>>{ dim.first, dim.second, table };
+	const hsize_t offset[2] = { rows.offset, 0 };
+	const hsize_t count[2] = { rows.count, dim.second };
+	file_space.selectHyperslab(H5S_SELECT_SET, count, offset);
+	const H5::DataSpace memory_space(2, count);
+
+	h5_table_data<real_type> result{ rows.count, dim.second, std::unique_ptr<real_type[]>(new real_type[rows.count * dim.second]) };
+	h5_read_table_data(table.first, table.second, result.data.get(), memory_space, file_space);
+	return result;
+}
+
+// Read the energy axis of a group, restricted to the rows needed for the energy window.
+// The rows are found in double precision, whatever the precision of the axis.
+template<typename real_type>
+std::pair<ax_list<real_type>, h5_rows> h5_read_energy_axis(H5::Group const & group, std::pair<double, double> window)
+{
+	const std::vector<double> energy = h5_read_1D_table(group, "energy", dimensions::energy);
+	const h5_rows rows = h5_find_rows(energy, window);
+	return
+	{
+		std::vector<real_type>(energy.begin() + rows.offset, energy.begin() + rows.offset + rows.count),
+		rows
+	};
 }
 
 // Read the "properties" dataset: array of compound datatype
 // [string name] [float value] [string unit]
 std::map<std::string, quantity<double>> h5_read_properties(H5::Group const & group)
 {
-	unit_parser _unit_parser;
-	_unit_parser.add_default_units();
-
 	H5::DataSet dataset = group.openDataSet("properties");
 	H5::DataSpace dataspace = dataset.getSpace();
 
@@ -133,7 +288,7 @@ std::map<std::string, quantity<double>> h5_read_properties(H5::Group const & gro
 	for (auto property : table)
 	{
 		std::string name(property.name);
-		quantity<double> value(property.value * _unit_parser.parse_unit(property.unit));
+		quantity<double> value(property.value * unit_parser::parse_default_unit(property.unit));
 		property_map[name] = value;
 	}
 
@@ -143,300 +298,1809 @@ std::map<std::string, quantity<double>> h5_read_properties(H5::Group const & gro
 	return property_map;
 }
 
+// Property in the precision of the intern tables
+template<typename real_type>
+quantity<real_type> quantity_cast(quantity<double> const & q)
+{
+	return{ static_cast<real_type>(q.value), q.units };
+}
+
+template<typename real_type>
 std::pair<
-	array1D_ax<double, ax_list<double>>,                     // cross_section(energy)
-	array2D_ax<double, ax_list<double>, ax_linspace<double>> // angle_icdf(energy, P)
-> read_elastic(H5::Group const & elastic_group)
+	array1D_ax<real_type, ax_list<real_type>>,                        // cross_section(energy)
+	array2D_ax<real_type, ax_list<real_type>, ax_linspace<real_type>> // angle_icdf(energy, P)
+> read_elastic(H5::Group const & elastic_group, std::pair<double, double> window)
 {
 	// Read energy axis
-	ax_list<double> energy_axis(h5_read_1D_table(elastic_group, "energy", dimensions::energy));
+	ax_list<real_type> energy_axis;
+	h5_rows rows;
+	std::tie(energy_axis, rows) = h5_read_energy_axis<real_type>(elastic_group, window);
 
 	// Read cross sections
-	std::vector<double> cross_section_table(h5_read_1D_table(elastic_group, "cross_section", dimensions::area));
-	if (cross_section_table.size() != energy_axis.size())
-		throw std::runtime_error("Cross section table has different size than energy table.");
+	h5_table_data<real_type> cross_section_table = h5_read_1D_data<real_type>(elastic_group, "cross_section", dimensions::area, rows);
 
 	// Read inverse cumulative differential cross section
-	size_t icdf_width, icdf_height;
-	std::vector<double> icdf_table;
-	std::tie(icdf_width, icdf_height, icdf_table) = h5_read_2D_table(elastic_group, "angle_icdf", dimensions::dimensionless); // radian
-	if (icdf_width != energy_axis.size())
-		throw std::runtime_error("ICDF table has different size than energy table.");
+	h5_table_data<real_type> icdf_table = h5_read_2D_data<real_type>(elastic_group, "angle_icdf", dimensions::dimensionless, rows); // radian
 
 	// Assemble into arrays and we are done.
 	return
 	{
-		{energy_axis, cross_section_table},
-		{energy_axis, ax_linspace<double>(0, 1, icdf_height), icdf_table}
+		{ energy_axis, std::move(cross_section_table.data) },
+		{ std::move(energy_axis), ax_linspace<real_type>(0, 1, icdf_table.height), std::move(icdf_table.data) }
 	};
 }
 
+template<typename real_type>
 std::pair<
-	array1D_ax<double, ax_list<double>>,                     // cross_section(energy)
-	array2D_ax<double, ax_list<double>, ax_linspace<double>> // w0_icdf(energy, P)
-> read_inelastic(H5::Group const & inelastic_group)
+	array1D_ax<real_type, ax_list<real_type>>,                        // cross_section(energy)
+	array2D_ax<real_type, ax_list<real_type>, ax_linspace<real_type>> // w0_icdf(energy, P)
+> read_inelastic(H5::Group const & inelastic_group, std::pair<double, double> window)
 {
 	// Read energy axis
-	ax_list<double> energy_axis(h5_read_1D_table(inelastic_group, "energy", dimensions::energy));
+	ax_list<real_type> energy_axis;
+	h5_rows rows;
+	std::tie(energy_axis, rows) = h5_read_energy_axis<real_type>(inelastic_group, window);
 
 	// Read cross sections
-	std::vector<double> cross_section_table(h5_read_1D_table(inelastic_group, "cross_section", dimensions::area));
-	if (cross_section_table.size() != energy_axis.size())
-		throw std::runtime_error("Cross section table has different size than energy table.");
+	h5_table_data<real_type> cross_section_table = h5_read_1D_data<real_type>(inelastic_group, "cross_section", dimensions::area, rows);
 
 	// Read inverse cumulative differential cross section
-	size_t icdf_width, icdf_height;
-	std::vector<double> icdf_table;
-	std::tie(icdf_width, icdf_height, icdf_table) = h5_read_2D_table(inelastic_group, "w0_icdf", dimensions::energy);
-	if (icdf_width != energy_axis.size())
-		throw std::runtime_error("ICDF table has different size than energy table.");
+	h5_table_data<real_type> icdf_table = h5_read_2D_data<real_type>(inelastic_group, "w0_icdf", dimensions::energy, rows);
 
 	// Assemble into arrays and we are done.
 	return
 	{
-		{ energy_axis, cross_section_table },
-		{ energy_axis, ax_linspace<double>(0, 1, icdf_height), icdf_table }
+		{ energy_axis, std::move(cross_section_table.data) },
+		{ std::move(energy_axis), ax_linspace<real_type>(0, 1, icdf_table.height), std::move(icdf_table.data) }
 	};
 }
 
-array2D_ax<double, ax_list<double>, ax_linspace<double>> // dE_icdf(energy, P)
-read_ionization(H5::Group const & ionization_group)
+template<typename real_type>
+array2D_ax<real_type, ax_list<real_type>, ax_linspace<real_type>> // dE_icdf(energy, P)
+read_ionization(H5::Group const & ionization_group, std::pair<double, double> window)
 {
 	// Read energy axis
-	ax_list<double> energy_axis(h5_read_1D_table(ionization_group, "energy", dimensions::energy));
+	ax_list<real_type> energy_axis;
+	h5_rows rows;
+	std::tie(energy_axis, rows) = h5_read_energy_axis<real_type>(ionization_group, window);
 
 	// Read inverse cumulative differential cross section
-	size_t icdf_width, icdf_height;
-	std::vector<double> icdf_table;
-	std::tie(icdf_width, icdf_height, icdf_table) = h5_read_2D_table(ionization_group, "dE_icdf", dimensions::energy);
-	if (icdf_width != energy_axis.size())
-		throw std::runtime_error("ICDF table has different size than energy table.");
+	h5_table_data<real_type> icdf_table = h5_read_2D_data<real_type>(ionization_group, "dE_icdf", dimensions::energy, rows);
 
 	// Assemble into arrays and we are done.
-	return{ energy_axis, ax_linspace<double>(0, 1, icdf_height), icdf_table };
+	return{ std::move(energy_axis), ax_linspace<real_type>(0, 1, icdf_table.height), std::move(icdf_table.data) };
 }
 
-array1D_ax<double, ax_list<double>> read_electron_range(H5::Group const & electron_range_group)
+template<typename real_type>
+array1D_ax<real_type, ax_list<real_type>> read_electron_range(H5::Group const & electron_range_group, std::pair<double, double> window)
 {
 	// Read energy axis
-	ax_list<double> energy_axis(h5_read_1D_table(electron_range_group, "energy", dimensions::energy));
+	ax_list<real_type> energy_axis;
+	h5_rows rows;
+	std::tie(energy_axis, rows) = h5_read_energy_axis<real_type>(electron_range_group, window);
 
-	// Read cross sections
-	std::vector<double> range_table(h5_read_1D_table(electron_range_group, "range", dimensions::length));
-	if (range_table.size() != energy_axis.size())
-		throw std::runtime_error("Range table has different size than energy table.");
+	// Read electron range
+	h5_table_data<real_type> range_table = h5_read_1D_data<real_type>(electron_range_group, "range", dimensions::length, rows);
 
 	// Assemble into arrays and we are done.
-	return {energy_axis, range_table};
+	return{ std::move(energy_axis), std::move(range_table.data) };
 }
 
-std::vector<double> read_outer_shells(H5::Group const & ionization_group)
+template<typename real_type>
+std::vector<real_type> read_outer_shells(H5::Group const & ionization_group)
 {
 	// Read outer shell energies
-	return h5_read_1D_table(ionization_group, "outer_shells", dimensions::energy);
+	const std::vector<double> outer_shells = h5_read_1D_table(ionization_group, "outer_shells", dimensions::energy);
+	return std::vector<real_type>(outer_shells.begin(), outer_shells.end());
 }
 
-material::material(std::string const & filename)
+/*
+ * Call f(begin, end) for blocks of the range [0, N), using N_threads threads
+ * (one per hardware thread if zero). Exceptions are rethrown in the caller.
+ */
+template<typename block_func>
+void parallel_blocks(size_t N, unsigned int N_threads, block_func f)
 {
-	try
-	{
-		H5::Exception::dontPrint();
-		H5::H5File hdf5_file(filename, H5F_ACC_RDONLY);
-
-		std::tie(elastic_cross_section, elastic_angle_icdf) = read_elastic(hdf5_file.openGroup("elastic"));
-		std::tie(inelastic_cross_section, inelastic_w0_icdf) = read_inelastic(hdf5_file.openGroup("inelastic"));
-		ionization_dE_icdf = read_ionization(hdf5_file.openGroup("ionization"));
-		outer_shells = read_outer_shells(hdf5_file.openGroup("ionization"));
-		electron_range = read_electron_range(hdf5_file.openGroup("electron_range"));
-		
-		// Read a few properties
-		name = h5_read_attribute(hdf5_file, "name");
-		auto cnd_type_str = h5_read_attribute(hdf5_file, "conductor_type");
-		auto property_map = h5_read_properties(hdf5_file);
-
-		if (cnd_type_str == "metal")
-			conductor_type = CND_METAL;
-		else if (cnd_type_str == "insulator")
-			conductor_type = CND_INSULATOR;
-		else if (cnd_type_str == "semiconductor")
-			conductor_type = CND_SEMICONDUCTOR;
-		else
-			throw std::runtime_error("Unknown conductor_type " + cnd_type_str);
+	if (N_threads == 0)
+		N_threads = std::thread::hardware_concurrency();
+	// Enough blocks to balance the load, not so many that claiming them costs.
+	const size_t block_size = std::max<size_t>(1, N / (8 * std::max(1u, N_threads)));
+	const size_t N_blocks = (N + block_size - 1) / block_size;
+	N_threads = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(N_threads, N_blocks)));
 
-		fermi = property_map.at("fermi");
-		density = property_map.at("density");
-		phonon_loss = property_map.at("phonon_loss");
-		barrier = property_map.at("barrier");
-		effective_A = property_map.at("effective_A");
-		band_gap = (conductor_type == CND_METAL ? -1.*units::eV : property_map.at("band_gap"));
-	}
-	catch (H5::Exception const & error)
+	if (N_threads == 1)
 	{
-		// HDF5 exception?
-		// Simply rethrow as a std::runtime_error.
-		throw std::runtime_error("Error encountered while reading HDF5 file: " + error.getDetailMsg());
+		f(size_t(0), N);
+		return;
 	}
+
+	// Each worker takes the next unclaimed block until all are done.
+	std::atomic<size_t> next_block(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]()
+	{
+		try
+		{
+			for (size_t b = next_block++; b < N_blocks; b = next_block++)
+				f(b * block_size, std::min(N, (b + 1) * block_size));
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard(error_mutex);
+			if (!error)
+				error = std::current_exception();
+			next_block = N_blocks;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < N_threads; ++t)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
 }
 
-std::string material::get_name() const
+/*
+ * Automatic sizing of fast tables, see material_base::accuracy_target.
+ */
+
+const size_t accuracy_max_N_1D = 1 << 16;
+const size_t accuracy_max_N_2D = 1 << 12;
+
+// Error of a fast value with respect to the intern value. Not-a-number counts as infinite.
+double accuracy_error(double fast, double intern, bool relative)
 {
-	return name;
+	const double difference = std::abs(fast - intern);
+	const double error = (relative && intern != 0) ? difference / std::abs(intern) : difference;
+	return std::isnan(error) ? std::numeric_limits<double>::infinity() : error;
 }
-auto material::get_conductor_type() const -> conductor_type_t
+
+// Smallest N in [N_min, N_max] with error(N) <= max_error, assuming that the
+// error decreases with N: double N until the target is met, then bisect.
+// Returns N_max if the target is not met there either.
+template<typename error_func>
+size_t smallest_grid(size_t N_min, size_t N_max, double max_error, error_func error)
 {
-	return conductor_type;
+	if (error(N_min) <= max_error)
+		return N_min;
+
+	size_t failed = N_min;
+	size_t passed = 0;
+	while (passed == 0)
+	{
+		if (failed >= N_max)
+			return N_max;
+		const size_t N = std::min(2 * failed, N_max);
+		if (error(N) <= max_error)
+			passed = N;
+		else
+			failed = N;
+	}
+
+	while (passed - failed > 1)
+	{
+		const size_t N = failed + (passed - failed) / 2;
+		if (error(N) <= max_error)
+			passed = N;
+		else
+			failed = N;
+	}
+	return passed;
 }
-auto material::get_fermi() const -> quantity<intern_real>
+
+// Size a 1D table that stores log(scale * intern), like the IMFP tables.
+template<typename intern_table_t, typename fast_real>
+material_base::accuracy_report size_loglog_table(intern_table_t const & intern, double scale,
+	fast_real K_min, fast_real K_max, material_base::accuracy_target const & target)
 {
-	return fermi;
+	using table_t = imfp_table<fast_real>;
+
+	// Intern grid points in range
+	std::vector<fast_real> K_intern;
+	for (size_t i = 0; i < intern.size(); ++i)
+	{
+		const double K = intern.get_x(i);
+		if (K >= K_min && K <= K_max)
+			K_intern.push_back((fast_real)K);
+	}
+
+	auto table_error = [&](size_t N) -> double
+	{
+		const ax_logspace<fast_real> K_axis(K_min, K_max, N);
+		std::unique_ptr<fast_real[]> values(new fast_real[N]);
+		for (size_t i = 0; i < N; ++i)
+		{
+			values[i] = (fast_real)std::log(scale * intern.at_loglog(K_axis[i]));
+		}
+		typename table_t::base_type log_table(K_axis, std::move(values));
+		const table_t table(std::move(log_table));
+
+		double max_error = 0;
+		auto test = [&](fast_real K)
+		{
+			const double reference = scale * intern.at_loglog(K);
+			if (std::isfinite(reference))
+				max_error = std::max(max_error, accuracy_error(table.get(K), reference, target.relative));
+		};
+		for (fast_real K : K_intern)
+			test(K);
+		for (size_t i = 0; i + 1 < N; ++i)
+			test(std::sqrt(K_axis[i] * K_axis[i + 1]));
+		return max_error;
+	};
+
+	material_base::accuracy_report report;
+	report.N_K = smallest_grid(2, accuracy_max_N_1D, target.max_error, table_error);
+	report.max_error = table_error(report.N_K);
+	report.met = (report.max_error <= target.max_error);
+	return report;
 }
-auto material::get_density() const -> quantity<intern_real>
+
+// Size a 2D table that stores the intern values, like the ICDF tables.
+// Half the error budget is given to each axis, to find the size along that
+// axis with the other one exact. The combined table is then checked, and
+// grown if needed.
+template<typename intern_table_t, typename fast_real>
+material_base::accuracy_report size_icdf_table(intern_table_t const & intern,
+	fast_real K_min, fast_real K_max, material_base::accuracy_target const & target)
 {
-	return density;
+	using table_t = icdf_table<fast_real>;
+
+	// Test points on the intern grid, and their true indices in the intern table.
+	std::vector<fast_real> K_intern;
+	std::vector<double> true_K_intern;
+	for (size_t i = 0; i < intern.width(); ++i)
+	{
+		const double K = intern.get_x(i);
+		if (K >= K_min && K <= K_max)
+		{
+			K_intern.push_back((fast_real)K);
+			true_K_intern.push_back(intern.find_x((fast_real)K));
+		}
+	}
+	std::vector<fast_real> P_intern;
+	std::vector<double> true_P_intern;
+	for (size_t j = 0; j < intern.height(); ++j)
+	{
+		P_intern.push_back((fast_real)intern.get_y(j));
+		true_P_intern.push_back(intern.find_y((fast_real)intern.get_y(j)));
+	}
+	const double axis_budget = target.max_error / 2;
+
+	// Interpolation in P only, in rows at the intern energies
+	auto P_error = [&](size_t N_P) -> double
+	{
+		const ax_unit_interval<fast_real> P_axis(N_P);
+		std::vector<double> true_P(N_P);
+		for (size_t j = 0; j < N_P; ++j)
+			true_P[j] = intern.find_y(P_axis[j]);
+
+		double max_error = 0;
+		std::vector<double> row(N_P);
+		for (double true_K : true_K_intern)
+		{
+			for (size_t j = 0; j < N_P; ++j)
+				row[j] = intern.at_linear_index(true_K, true_P[j]);
+
+			auto test = [&](double P, double true_P_intern)
+			{
+				const double fast_P = _clamp<double>(P * (N_P - 1), 0, N_P - 1);
+				const size_t low = std::min<size_t>(static_cast<size_t>(fast_P), N_P - 2);
+				const double frac = fast_P - low;
+				const double reference = intern.at_linear_index(true_K, true_P_intern);
+				if (std::isfinite(reference))
+					max_error = std::max(max_error, accuracy_error((1 - frac)*row[low] + frac*row[low + 1], reference, target.relative));
+			};
+			for (size_t j = 0; j < P_intern.size(); ++j)
+				test(P_intern[j], true_P_intern[j]);
+			for (size_t j = 0; j + 1 < N_P; ++j)
+			{
+				const fast_real P = (P_axis[j] + P_axis[j + 1]) / 2;
+				test(P, intern.find_y(P));
+			}
+		}
+		return max_error;
+	};
+
+	// Interpolation in K only, in columns at the intern probabilities
+	auto K_error = [&](size_t N_K) -> double
+	{
+		const ax_logspace<fast_real> K_axis(K_min, K_max, N_K);
+		std::vector<double> true_K(N_K);
+		for (size_t i = 0; i < N_K; ++i)
+			true_K[i] = intern.find_x(K_axis[i]);
+
+		// Test points, with their position in the fast and intern tables
+		std::vector<std::pair<double, double>> tests;
+		for (size_t i = 0; i < K_intern.size(); ++i)
+			tests.emplace_back(K_axis.find(K_intern[i]), true_K_intern[i]);
+		for (size_t i = 0; i + 1 < N_K; ++i)
+		{
+			const fast_real K = std::sqrt(K_axis[i] * K_axis[i + 1]);
+			tests.emplace_back(K_axis.find(K), intern.find_x(K));
+		}
+
+		double max_error = 0;
+		std::vector<double> column(N_K);
+		for (double true_P : true_P_intern)
+		{
+			for (size_t i = 0; i < N_K; ++i)
+				column[i] = intern.at_linear_index(true_K[i], true_P);
+
+			for (auto const & test : tests)
+			{
+				const double fast_K = _clamp<double>(test.first, 0, N_K - 1);
+				const size_t low = std::min<size_t>(static_cast<size_t>(fast_K), N_K - 2);
+				const double frac = fast_K - low;
+				const double reference = intern.at_linear_index(test.second, true_P);
+				if (std::isfinite(reference))
+					max_error = std::max(max_error, accuracy_error((1 - frac)*column[low] + frac*column[low + 1], reference, target.relative));
+			}
+		}
+		return max_error;
+	};
+
+	// The table as it will be built, in fast_real precision
+	auto table_error = [&](size_t N_K, size_t N_P) -> double
+	{
+		const ax_logspace<fast_real> K_axis(K_min, K_max, N_K);
+		const ax_unit_interval<fast_real> P_axis(N_P);
+		std::unique_ptr<fast_real[]> values(new fast_real[N_K*N_P]);
+		std::vector<double> true_P(N_P);
+		for (size_t j = 0; j < N_P; ++j)
+			true_P[j] = intern.find_y(P_axis[j]);
+		for (size_t i = 0; i < N_K; ++i)
+		{
+			const double true_K = intern.find_x(K_axis[i]);
+			for (size_t j = 0; j < N_P; ++j)
+				values[i*N_P + j] = (fast_real)intern.at_linear_index(true_K, true_P[j]);
+		}
+		typename table_t::base_type base_table(K_axis, P_axis, std::move(values));
+		const table_t table(std::move(base_table));
+
+		std::vector<fast_real> K_tests(K_intern);
+		for (size_t i = 0; i + 1 < N_K; ++i)
+			K_tests.push_back(std::sqrt(K_axis[i] * K_axis[i + 1]));
+		std::vector<fast_real> P_tests(P_intern);
+		for (size_t j = 0; j + 1 < N_P; ++j)
+			P_tests.push_back((P_axis[j] + P_axis[j + 1]) / 2);
+		std::vector<double> true_P_tests(P_tests.size());
+		for (size_t j = 0; j < P_tests.size(); ++j)
+			true_P_tests[j] = intern.find_y(P_tests[j]);
+
+		double max_error = 0;
+		for (fast_real K : K_tests)
+		{
+			const double true_K = intern.find_x(K);
+			for (size_t j = 0; j < P_tests.size(); ++j)
+			{
+				const double reference = intern.at_linear_index(true_K, true_P_tests[j]);
+				if (std::isfinite(reference))
+					max_error = std::max(max_error, accuracy_error(table.get(K, P_tests[j]), reference, target.relative));
+			}
+		}
+		return max_error;
+	};
+
+	material_base::accuracy_report report;
+	report.N_K = smallest_grid(2, accuracy_max_N_2D, axis_budget, K_error);
+	report.N_P = smallest_grid(2, accuracy_max_N_2D, axis_budget, P_error);
+	report.max_error = table_error(report.N_K, report.N_P);
+	while (report.max_error > target.max_error
+		&& (report.N_K < accuracy_max_N_2D || report.N_P < accuracy_max_N_2D))
+	{
+		report.N_K = std::min(accuracy_max_N_2D, report.N_K + report.N_K / 4 + 1);
+		report.N_P = std::min(accuracy_max_N_2D, report.N_P + report.N_P / 4 + 1);
+		report.max_error = table_error(report.N_K, report.N_P);
+	}
+	report.met = (report.max_error <= target.max_error);
+	return report;
 }
-auto material::get_phonon_loss() const -> quantity<intern_real>
+
+// Source hash for the keys of fast tables, so that the table cache and shared
+// memory only hand out tables built from the same intern tables:
+//  - Tables built from single precision intern tables differ slightly from
+//    those built from double precision ones.
+//  - With an energy window, only part of the intern tables is read; fast
+//    tables are extrapolated outside it.
+//  - On an energy axis other than ax_logspace, the range and size do not
+//    identify the axis; its hash is folded in.
+// Defaults (double precision, the whole energy range, ax_logspace) keep the
+// plain hash, so that existing caches remain valid.
+template<typename intern_real>
+uint64_t table_source_hash(uint64_t source_hash, std::pair<double, double> const & energy_window, uint64_t axis_hash)
 {
-	return phonon_loss;
+	uint64_t hash = source_hash;
+	if (sizeof(intern_real) != sizeof(double))
+	{
+		const uint32_t intern_size = sizeof(intern_real);
+		hash = table_cache::hash_bytes(&intern_size, sizeof(intern_size), hash);
+	}
+	if (!(energy_window.first <= 0 && std::isinf(energy_window.second)))
+	{
+		const double window[2] = { energy_window.first, energy_window.second };
+		hash = table_cache::hash_bytes(window, sizeof(window), hash);
+	}
+	if (axis_hash != 0)
+		hash = table_cache::hash_bytes(&axis_hash, sizeof(axis_hash), hash);
+	return hash;
 }
-auto material::get_effective_A() const -> quantity<intern_real>
+
+// Hash of the parameters of a piecewise energy axis, never zero.
+template<typename real_type>
+uint64_t axis_hash(ax_piecewise_logspace<real_type> const & axis)
 {
-	return effective_A;
+	const auto& edges = axis.get_edges();
+	const auto& intervals = axis.get_intervals();
+	uint64_t hash = table_cache::hash_bytes(edges.data(), edges.size() * sizeof(real_type));
+	for (size_t n : intervals)
+	{
+		const uint64_t n64 = n;
+		hash = table_cache::hash_bytes(&n64, sizeof(n64), hash);
+	}
+	return hash == 0 ? 1 : hash;
 }
-auto material::get_barrier() const -> quantity<intern_real>
+
+// Conversions from intern to fast table values, see material::to_fast_table.
+// Shared by the fast tables on all energy axes.
+
+// Log of a table with log-log interpolation, times scale
+template<typename intern_real, typename fast_real>
+struct log_loglog_conversion
 {
-	return barrier;
-}
-auto material::get_band_gap() const -> quantity<intern_real>
+	intern_real scale;
+
+	template<typename intern_table_t>
+	fast_real operator()(intern_table_t const & table, intern_real K, intern_real true_K) const
+	{
+		const intern_real value = table.at_loglog_index(K, true_K);
+		return (fast_real)std::log(value * scale);
+	}
+};
+// Linear interpolation in a 2D table
+template<typename intern_real, typename fast_real>
+struct linear_conversion
 {
-	return band_gap;
-}
+	template<typename intern_table_t>
+	fast_real operator()(intern_table_t const & table, intern_real true_K, intern_real true_P) const
+	{
+		return (fast_real)table.at_linear_index(true_K, true_P);
+	}
+};
+// Binding energies, -1 for none
+template<typename intern_real, typename fast_real>
+struct binding_conversion
+{
+	template<typename intern_table_t>
+	fast_real operator()(intern_table_t const & table, intern_real true_K, intern_real true_P) const
+	{
+		intern_real binding = table.at_rounddown_index(true_K, true_P);
+
+		if (!std::isfinite(binding))
+			binding = -1;
+
+		return (fast_real)binding;
+	}
+};
 
-auto material::get_elastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> imfp_table_t
+// Fills the rows of a 2D fast table, with f at one true_K and all true_P.
+template<typename intern_table_t, typename conversion_func>
+class row_converter
 {
-	const intern_real number_density = get_density().value;
-	return to_fast_table(elastic_cross_section, K_min, K_max, N,
-		[number_density](intern_table1D_t const & table, intern_real K) -> fast_real
-		{
-			const intern_real cross_section = table.at_loglog(K);
-			return (fast_real)std::log(cross_section * number_density);
-		});
+public:
+	using x_type = typename intern_table_t::x_type;
+	using y_type = typename intern_table_t::y_type;
+
+	row_converter(intern_table_t const & table, std::vector<y_type> const & true_P, conversion_func f) :
+		_table(table), _true_P(true_P), _f(f)
+	{}
+
+	template<typename fast_real>
+	void fill_row(x_type true_K, fast_real* row) const
+	{
+		for (size_t ip = 0; ip < _true_P.size(); ++ip)
+			row[ip] = _f(_table, true_K, _true_P[ip]);
+	}
+
+private:
+	intern_table_t const & _table;
+	std::vector<y_type> const & _true_P;
+	conversion_func _f;
+};
+// Linear interpolation without branches in the inner loop, see linear_rows.h.
+template<typename intern_table_t, typename intern_real, typename fast_real>
+class row_converter<intern_table_t, linear_conversion<intern_real, fast_real>> :
+	public linear_rows<intern_table_t>
+{
+public:
+	row_converter(intern_table_t const & table, std::vector<typename intern_table_t::y_type> const & true_P,
+		linear_conversion<intern_real, fast_real>) :
+		linear_rows<intern_table_t>(table, true_P)
+	{}
+};
+
+// Memory held by an axis outside the axis object itself. Only ax_list stores
+// its points; these are shared between tables, and only counted for the first
+// table in "counted".
+template<typename real_type>
+size_t axis_heap_bytes(ax_list<real_type> const & axis, std::vector<void const *> & counted)
+{
+	if (std::find(counted.begin(), counted.end(), axis.data()) != counted.end())
+		return 0;
+	counted.push_back(axis.data());
+	return axis.size() * sizeof(real_type);
 }
-auto material::get_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> icdf_table_t
+template<typename axis_t>
+size_t axis_heap_bytes(axis_t const &, std::vector<void const *> &)
 {
-	return to_fast_table(elastic_angle_icdf, K_min, K_max, N_K, N_P,
-		[](intern_table2D_t const & table, intern_real K, intern_real P) -> fast_real
-		{
-			return (fast_real)table.at_linear(K, P);
-		});
+	return 0;
 }
-auto material::get_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> imfp_table_t
+
+// Memory held by an intern table; values that are not ours are mapped from a binary file.
+template<typename real_type, typename ax>
+material_base::table_memory table_memory_usage(material_base::table_kind_t kind,
+	array1D_ax<real_type, ax> const & table, std::vector<void const *> & counted_axes)
 {
-	intern_real number_density = get_density().value;
-	return to_fast_table(inelastic_cross_section, K_min, K_max, N,
-		[number_density](intern_table1D_t const & table, intern_real K) -> fast_real
-		{
-			const intern_real cross_section = table.at_loglog(K);
-			return (fast_real)std::log(cross_section * number_density);
-		});
+	const size_t value_bytes = table.size() * sizeof(real_type);
+	return{ kind,
+		axis_heap_bytes(table.get_x_axis(), counted_axes) + (table.owns_data() ? value_bytes : 0),
+		table.owns_data() ? 0 : value_bytes };
 }
-auto material::get_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> icdf_table_t
+template<typename real_type, typename ax_x, typename ax_y>
+material_base::table_memory table_memory_usage(material_base::table_kind_t kind,
+	array2D_ax<real_type, ax_x, ax_y> const & table, std::vector<void const *> & counted_axes)
 {
-	return to_fast_table(inelastic_w0_icdf, K_min, K_max, N_K, N_P,
-		[](intern_table2D_t const & table, intern_real K, intern_real P) -> fast_real
-		{
-			return (fast_real)table.at_linear(K, P);
-		});
+	const size_t value_bytes = table.size() * sizeof(real_type);
+	return{ kind,
+		axis_heap_bytes(table.get_x_axis(), counted_axes) + axis_heap_bytes(table.get_y_axis(), counted_axes)
+			+ (table.owns_data() ? value_bytes : 0),
+		table.owns_data() ? 0 : value_bytes };
 }
 
-auto material::get_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> ionization_table_t
+/*
+ * State for loading tables lazily.
+ * The HDF5 file is kept open until all selected processes have been read.
+ */
+template<typename intern_real_type, typename fast_real_type>
+struct basic_material<intern_real_type, fast_real_type>::loader_t
 {
-	return to_fast_table(ionization_dE_icdf, K_min, K_max, N_K, N_P,
-		[](intern_table2D_t const & table, intern_real K, intern_real P) -> fast_real
-		{
-			intern_real binding = table.at_rounddown(K, P);
+	std::mutex mutex;
+	std::atomic<unsigned int> pending; // Processes that still have to be read
+	std::unique_ptr<file_image> image; // Backs the file, for io_strategy other than IO_HDF5
+	std::shared_ptr<std::vector<char> const> buffer; // Backs the file, if loaded from a file image
+	std::unique_ptr<H5::H5File> file;
 
-			if (!std::isfinite(binding))
-				binding = -1;
+	~loader_t()
+	{
+		// HDF5 objects must only be touched with the HDF5 lock held.
+		auto lock = h5_lock();
+		file.reset();
+	}
+};
 
-			return (fast_real)binding;
-		});
-}
+const material_base::process_t all_processes[] =
+{
+	material_base::PROC_ELASTIC,
+	material_base::PROC_INELASTIC,
+	material_base::PROC_IONIZATION,
+	material_base::PROC_ELECTRON_RANGE
+};
 
-auto material::get_outer_shells() const -> outer_shell_table_t
+/*
+ * Fast tables handed out by the get_shared_* functions.
+ * The future is stored as soon as a thread starts building a table, so
+ * that other threads asking for the same table wait for it.
+ */
+template<typename intern_real_type, typename fast_real_type>
+struct basic_material<intern_real_type, fast_real_type>::shared_tables_t
 {
-	std::vector<fast_real> return_vector(outer_shells.size());
-	for (size_t i = 0; i < outer_shells.size(); ++i)
-		return_vector[i] = (fast_real)outer_shells[i];
-	return return_vector;
-}
+	using key_t = std::tuple<table_kind_t, fast_real, fast_real, size_t, size_t>;
 
-auto material::get_electron_range(fast_real K_min, fast_real K_max, size_t N) const -> range_table_t
+	std::mutex mutex;
+	std::map<key_t, std::shared_future<std::shared_ptr<void const>>> tables;
+};
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material() :
+	shared_fast_tables(new shared_tables_t)
+{}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(std::string const & filename) :
+	basic_material(filename, load_options())
+{}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(std::string const & filename, load_options const & options) :
+	source_filename(filename), options(options), shared_fast_tables(new shared_tables_t)
 {
-	return to_fast_table(electron_range, K_min, K_max, N,
-		[](intern_table1D_t const & table, intern_real K) -> fast_real
+	try
+	{
+		// Read the file ourselves, if so requested.
+		std::unique_ptr<file_image> image;
+		if (options.io_strategy != IO_HDF5)
 		{
-			const intern_real electron_range = table.at_loglog(K);
-			return (fast_real)std::log(electron_range);
-		});
+			image.reset(new file_image(filename,
+				options.io_strategy == IO_MMAP ? file_image::MMAP : file_image::READ, io_stats));
+		}
+
+		// Hold the lock until all HDF5 objects have gone out of scope.
+		auto lock = h5_lock();
+		H5::Exception::dontPrint();
+		process_io_counter counter(io_stats, image == nullptr);
+		std::unique_ptr<H5::H5File> hdf5_file = (image == nullptr
+			? std::unique_ptr<H5::H5File>(new H5::H5File(filename, H5F_ACC_RDONLY))
+			: h5_open_image(image->data(), image->size(), false));
+		read_hdf5(std::move(hdf5_file), std::move(image));
+	}
+	catch (H5::Exception const & error)
+	{
+		// HDF5 exception?
+		// Simply rethrow as a std::runtime_error.
+		throw std::runtime_error("Error encountered while reading HDF5 file: " + error.getDetailMsg());
+	}
 }
 
-auto material::get_elastic_energy_range() const -> std::pair<intern_real, intern_real>
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(void const * buffer, size_t size) :
+	basic_material(buffer, size, load_options())
+{}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(void const * buffer, size_t size, load_options const & options) :
+	options(options), shared_fast_tables(new shared_tables_t)
 {
-	// Note: the energy axis is shared between the cross section and icdf tables.
-	return elastic_cross_section.get_xrange();
+	// Our own copy backs the HDF5 file. It is hashed now, as it is gone by the
+	// time a cache may be set: it is freed below, or by require() if loading lazily.
+	char const * bytes = static_cast<char const *>(buffer);
+	std::shared_ptr<std::vector<char>> image = std::make_shared<std::vector<char>>(bytes, bytes + size);
+	source_hash = table_cache::hash_bytes(image->data(), image->size());
+	try
+	{
+		// Hold the lock until all HDF5 objects have gone out of scope.
+		auto lock = h5_lock();
+		H5::Exception::dontPrint();
+		read_hdf5(h5_open_image(image->data(), image->size(), false), nullptr);
+		if (loader != nullptr)
+			loader->buffer = std::move(image);
+	}
+	catch (H5::Exception const & error)
+	{
+		throw std::runtime_error("Error encountered while reading HDF5 file image: " + error.getDetailMsg());
+	}
 }
 
-auto material::get_inelastic_energy_range() const -> std::pair<intern_real, intern_real>
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::read_hdf5(std::unique_ptr<H5::H5File> hdf5_file, std::unique_ptr<file_image> image)
 {
-	// Note: the energy axis is shared between the cross section and icdf tables.
-	return inelastic_cross_section.get_xrange();
+	// Read a few properties
+	name = h5_read_attribute(*hdf5_file, "name");
+	auto cnd_type_str = h5_read_attribute(*hdf5_file, "conductor_type");
+	auto property_map = h5_read_properties(*hdf5_file);
+
+	if (cnd_type_str == "metal")
+		conductor_type = CND_METAL;
+	else if (cnd_type_str == "insulator")
+		conductor_type = CND_INSULATOR;
+	else if (cnd_type_str == "semiconductor")
+		conductor_type = CND_SEMICONDUCTOR;
+	else
+		throw std::runtime_error("Unknown conductor_type " + cnd_type_str);
+
+	fermi = quantity_cast<intern_real>(property_map.at("fermi"));
+	density = quantity_cast<intern_real>(property_map.at("density"));
+	phonon_loss = quantity_cast<intern_real>(property_map.at("phonon_loss"));
+	barrier = quantity_cast<intern_real>(property_map.at("barrier"));
+	effective_A = quantity_cast<intern_real>(property_map.at("effective_A"));
+	band_gap = quantity_cast<intern_real>(conductor_type == CND_METAL ? -1.*units::eV : property_map.at("band_gap"));
+
+	// Read tables, or leave the file open for reading them later.
+	if (options.lazy)
+	{
+		loader.reset(new loader_t);
+		loader->pending = options.processes & PROC_ALL;
+		loader->image = std::move(image);
+		loader->file = std::move(hdf5_file);
+	}
+	else
+	{
+		for (process_t process : all_processes)
+		{
+			if (options.processes & process)
+				read_process(*hdf5_file, process);
+		}
+		// Close the file before the image backing it goes away
+		hdf5_file.reset();
+	}
 }
 
-auto material::get_ionization_energy_range() const -> std::pair<intern_real, intern_real>
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::~basic_material() = default;
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(basic_material &&) = default;
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>& basic_material<intern_real_type, fast_real_type>::operator=(basic_material &&) = default;
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>::basic_material(basic_material const & other) :
+	basic_material()
 {
-	return ionization_dE_icdf.get_xrange();
+	*this = other;
 }
-
-auto material::get_electron_range_energy_range() const -> std::pair<intern_real, intern_real>
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type>& basic_material<intern_real_type, fast_real_type>::operator=(basic_material const & other)
 {
-	return electron_range.get_xrange();
+	if (this == &other)
+		return *this;
+
+	// Copy loaded tables only
+	copy_from(other, other.released ? 0 : other.options.processes);
+	return *this;
 }
 
-template<typename conversion_func>
-auto material::to_fast_table(intern_table1D_t const & intern,
-	fast_real K_min, fast_real K_max, size_t N, conversion_func f) -> fast_table1D_t
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::copy_from(basic_material const & other, unsigned int processes)
 {
-	// Kinetic energy axis
-	ax_logspace<fast_real> K_axis(K_min, K_max, N);
-
-	// Values
-	std::vector<fast_real> values(N);
-	for (size_t i = 0; i < N; ++i)
+	for (process_t process : all_processes)
 	{
-		values[i] = f(intern, K_axis[i]);
+		if (processes & process)
+			other.require(process);
 	}
 
-	return{ K_axis, values };
+	source_filename = other.source_filename;
+	source_hash = other.source_hash;
+	cache = other.cache;
+	shared_tables = other.shared_tables;
+	binary_file = other.binary_file;
+	options = other.options;
+	loader.reset();
+	released = other.released;
+	shared_fast_tables.reset(new shared_tables_t);
+	io_stats = other.get_io_statistics();
+	build_threads = other.build_threads;
+
+	name = other.name;
+	conductor_type = other.conductor_type;
+	fermi = other.fermi;
+	density = other.density;
+	phonon_loss = other.phonon_loss;
+	barrier = other.barrier;
+	effective_A = other.effective_A;
+	band_gap = other.band_gap;
+
+	const bool elastic = (processes & PROC_ELASTIC) != 0;
+	const bool inelastic = (processes & PROC_INELASTIC) != 0;
+	const bool ionization = (processes & PROC_IONIZATION) != 0;
+	const bool range = (processes & PROC_ELECTRON_RANGE) != 0;
+	elastic_cross_section = elastic ? other.elastic_cross_section : intern_table1D_t();
+	elastic_angle_icdf = elastic ? other.elastic_angle_icdf : intern_table2D_t();
+	inelastic_cross_section = inelastic ? other.inelastic_cross_section : intern_table1D_t();
+	inelastic_w0_icdf = inelastic ? other.inelastic_w0_icdf : intern_table2D_t();
+	ionization_dE_icdf = ionization ? other.ionization_dE_icdf : intern_table2D_t();
+	outer_shells = ionization ? other.outer_shells : std::vector<intern_real>();
+	electron_range = range ? other.electron_range : intern_table1D_t();
 }
 
-template<typename conversion_func>
-auto material::to_fast_table(intern_table2D_t const & intern,
-	fast_real K_min, fast_real K_max, size_t N_K, size_t N_P, conversion_func f) -> fast_table2D_t
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::set_build_threads(unsigned int N_threads)
 {
-	// Kinetic energy axis
-	ax_logspace<fast_real> K_axis(K_min, K_max, N_K);
-	// Probability axis
-	ax_linspace<fast_real> P_axis(0, 1, N_P);
+	build_threads = N_threads;
+}
 
-	// Values
-	std::vector<fast_real> values(N_K*N_P);
-	for (size_t ik = 0; ik < N_K; ++ik)
-	{
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::release_source_tables()
+{
+	released = true;
+	loader.reset();
+
+	elastic_cross_section = intern_table1D_t();
+	elastic_angle_icdf = intern_table2D_t();
+	inelastic_cross_section = intern_table1D_t();
+	inelastic_w0_icdf = intern_table2D_t();
+	ionization_dE_icdf = intern_table2D_t();
+	outer_shells = std::vector<intern_real>();
+	electron_range = intern_table1D_t();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::memory_usage() const -> memory_report
+{
+	// Processes whose tables are loaded. Hold the loader's lock, so that these
+	// are not being read while we look at them.
+	std::unique_lock<std::mutex> guard;
+	unsigned int loaded = (released ? 0 : options.processes);
+	memory_report report;
+	if (loader != nullptr)
+	{
+		guard = std::unique_lock<std::mutex>(loader->mutex);
+		loaded &= ~loader->pending.load(std::memory_order_relaxed);
+		if (loader->buffer != nullptr)
+			report.source_image_bytes = loader->buffer->capacity();
+	}
+
+	std::vector<void const *> counted_axes;
+	if (loaded & PROC_ELASTIC)
+	{
+		report.tables.push_back(table_memory_usage(TBL_ELASTIC_IMFP, elastic_cross_section, counted_axes));
+		report.tables.push_back(table_memory_usage(TBL_ELASTIC_ANGLE_ICDF, elastic_angle_icdf, counted_axes));
+	}
+	if (loaded & PROC_INELASTIC)
+	{
+		report.tables.push_back(table_memory_usage(TBL_INELASTIC_IMFP, inelastic_cross_section, counted_axes));
+		report.tables.push_back(table_memory_usage(TBL_INELASTIC_W0_ICDF, inelastic_w0_icdf, counted_axes));
+	}
+	if (loaded & PROC_IONIZATION)
+	{
+		report.tables.push_back(table_memory_usage(TBL_IONIZATION_ICDF, ionization_dE_icdf, counted_axes));
+		report.outer_shell_bytes = outer_shells.capacity() * sizeof(intern_real);
+	}
+	if (loaded & PROC_ELECTRON_RANGE)
+		report.tables.push_back(table_memory_usage(TBL_ELECTRON_RANGE, electron_range, counted_axes));
+
+	report.heap_bytes = report.outer_shell_bytes + report.source_image_bytes;
+	for (table_memory const & table : report.tables)
+		report.heap_bytes += table.heap_bytes;
+	return report;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+io_statistics basic_material<intern_real_type, fast_real_type>::get_io_statistics() const
+{
+	auto lock = h5_lock();
+	return io_stats;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::compute_source_hash()
+{
+	if (source_hash == 0)
+		source_hash = table_cache::hash_file(source_filename);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::set_table_cache(std::string const & directory)
+{
+	compute_source_hash();
+	cache = std::make_shared<table_cache>(directory);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::set_shared_tables(std::string const & prefix)
+{
+	compute_source_hash();
+	shared_tables = std::make_shared<shared_table_store>(prefix);
+}
+
+/*
+ * Binary files, see binary_material.h.
+ *
+ * Properties are stored in the order below; the conductor type is stored as a
+ * dimensionless property. The id of an intern table section is the table_kind_t
+ * of the corresponding fast table.
+ */
+enum binary_property_t
+{
+	BPROP_CONDUCTOR_TYPE,
+	BPROP_FERMI,
+	BPROP_DENSITY,
+	BPROP_PHONON_LOSS,
+	BPROP_BARRIER,
+	BPROP_EFFECTIVE_A,
+	BPROP_BAND_GAP,
+	BPROP_COUNT
+};
+
+template<typename real_type>
+binary_material_format::property_t to_binary_property(quantity<real_type> const & q)
+{
+	return{ q.value, { q.units.energy, q.units.length, q.units.time, q.units.temperature, q.units.charge }, 0 };
+}
+
+quantity<double> from_binary_property(binary_material_format::property_t const & p)
+{
+	return{ p.value, { p.units[0], p.units[1], p.units[2], p.units[3], p.units[4] } };
+}
+
+// Add an intern table to a binary file, as the energy axis followed by the values.
+// These are always stored in double precision.
+template<typename table_t>
+void add_binary_table(binary_material_writer& writer, uint32_t type, uint32_t id,
+	table_t const & table, size_t width, size_t height)
+{
+	std::vector<double> buffer(width + width*height);
+	for (size_t i = 0; i < width; ++i)
+		buffer[i] = table.get_x(i);
+	std::copy(table.data(), table.data() + width*height, buffer.begin() + width);
+
+	binary_material_format::section_t section{};
+	section.type = type;
+	section.id = id;
+	section.N[0] = width;
+	section.N[1] = height;
+	section.value_size = sizeof(double);
+	writer.add_section(section, buffer.data(), buffer.size() * sizeof(double));
+}
+
+// Value in a fast table, regardless of its dimension.
+template<typename real_type>
+real_type fast_table_value(imfp_table<real_type> const & table, size_t i, size_t)
+{
+	return table(i);
+}
+template<typename table_t>
+typename table_t::value_type fast_table_value(table_t const & table, size_t i, size_t j)
+{
+	return table(i, j);
+}
+
+// Add a fast table to a binary file.
+template<typename fast_table_spec, typename table_t>
+void add_binary_fast_table(binary_material_writer& writer, fast_table_spec const & spec,
+	table_t const & table, size_t height)
+{
+	using value_type = typename table_t::value_type;
+	std::vector<value_type> buffer(spec.N_K * height);
+	for (size_t i = 0; i < spec.N_K; ++i)
+		for (size_t j = 0; j < height; ++j)
+			buffer[i*height + j] = fast_table_value(table, i, j);
+
+	binary_material_format::section_t section{};
+	section.type = binary_material_format::SEC_FAST_TABLE;
+	section.id = spec.kind;
+	section.N[0] = spec.N_K;
+	section.N[1] = height;
+	section.K_range[0] = spec.K_min;
+	section.K_range[1] = spec.K_max;
+	section.value_size = sizeof(value_type);
+	writer.add_section(section, buffer.data(), buffer.size() * sizeof(value_type));
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::save_binary(std::string const & filename, std::vector<fast_table_spec> const & fast_tables) const
+{
+	using format = binary_material_format;
+	binary_material_writer writer;
+
+	format::section_t section{};
+	section.type = format::SEC_NAME;
+	writer.add_section(section, name.data(), name.size());
+
+	std::vector<format::property_t> properties(BPROP_COUNT);
+	properties[BPROP_CONDUCTOR_TYPE] = to_binary_property<double>(
+		{ static_cast<double>(conductor_type), dimensions::dimensionless });
+	properties[BPROP_FERMI] = to_binary_property(fermi);
+	properties[BPROP_DENSITY] = to_binary_property(density);
+	properties[BPROP_PHONON_LOSS] = to_binary_property(phonon_loss);
+	properties[BPROP_BARRIER] = to_binary_property(barrier);
+	properties[BPROP_EFFECTIVE_A] = to_binary_property(effective_A);
+	properties[BPROP_BAND_GAP] = to_binary_property(band_gap);
+	section.type = format::SEC_PROPERTIES;
+	section.N[0] = properties.size();
+	writer.add_section(section, properties.data(), properties.size() * sizeof(format::property_t));
+
+	// Intern tables, for the processes we have
+	if (options.processes & PROC_ELASTIC)
+	{
+		require(PROC_ELASTIC);
+		add_binary_table(writer, format::SEC_INTERN_1D, TBL_ELASTIC_IMFP,
+			elastic_cross_section, elastic_cross_section.size(), 1);
+		add_binary_table(writer, format::SEC_INTERN_2D, TBL_ELASTIC_ANGLE_ICDF,
+			elastic_angle_icdf, elastic_angle_icdf.width(), elastic_angle_icdf.height());
+	}
+	if (options.processes & PROC_INELASTIC)
+	{
+		require(PROC_INELASTIC);
+		add_binary_table(writer, format::SEC_INTERN_1D, TBL_INELASTIC_IMFP,
+			inelastic_cross_section, inelastic_cross_section.size(), 1);
+		add_binary_table(writer, format::SEC_INTERN_2D, TBL_INELASTIC_W0_ICDF,
+			inelastic_w0_icdf, inelastic_w0_icdf.width(), inelastic_w0_icdf.height());
+	}
+	if (options.processes & PROC_IONIZATION)
+	{
+		require(PROC_IONIZATION);
+		add_binary_table(writer, format::SEC_INTERN_2D, TBL_IONIZATION_ICDF,
+			ionization_dE_icdf, ionization_dE_icdf.width(), ionization_dE_icdf.height());
+
+		const std::vector<double> outer_shells_double(outer_shells.begin(), outer_shells.end());
+		section = format::section_t{};
+		section.type = format::SEC_OUTER_SHELLS;
+		section.N[0] = outer_shells_double.size();
+		section.value_size = sizeof(double);
+		writer.add_section(section, outer_shells_double.data(), outer_shells_double.size() * sizeof(double));
+	}
+	if (options.processes & PROC_ELECTRON_RANGE)
+	{
+		require(PROC_ELECTRON_RANGE);
+		add_binary_table(writer, format::SEC_INTERN_1D, TBL_ELECTRON_RANGE,
+			electron_range, electron_range.size(), 1);
+	}
+
+	// Prebuilt fast tables
+	for (fast_table_spec const & spec : fast_tables)
+	{
+		switch (spec.kind)
+		{
+		case TBL_ELASTIC_IMFP:
+			add_binary_fast_table(writer, spec, get_elastic_imfp(spec.K_min, spec.K_max, spec.N_K), 1);
+			break;
+		case TBL_ELASTIC_ANGLE_ICDF:
+			add_binary_fast_table(writer, spec, get_elastic_angle_icdf(spec.K_min, spec.K_max, spec.N_K, spec.N_P), spec.N_P);
+			break;
+		case TBL_INELASTIC_IMFP:
+			add_binary_fast_table(writer, spec, get_inelastic_imfp(spec.K_min, spec.K_max, spec.N_K), 1);
+			break;
+		case TBL_INELASTIC_W0_ICDF:
+			add_binary_fast_table(writer, spec, get_inelastic_w0_icdf(spec.K_min, spec.K_max, spec.N_K, spec.N_P), spec.N_P);
+			break;
+		case TBL_IONIZATION_ICDF:
+			add_binary_fast_table(writer, spec, get_ionization_icdf(spec.K_min, spec.K_max, spec.N_K, spec.N_P), spec.N_P);
+			break;
+		case TBL_ELECTRON_RANGE:
+			add_binary_fast_table(writer, spec, get_electron_range(spec.K_min, spec.K_max, spec.N_K), 1);
+			break;
+		}
+	}
+
+	writer.write(filename);
+}
+
+// Intern table from the N values at data in a binary file, which are doubles.
+// Double precision tables refer to the mapped file; other precisions are
+// converted, selected by the last parameter being std::false_type.
+template<typename table_t, typename... axis_t>
+table_t binary_intern_table(double* data, size_t, std::shared_ptr<void const> const & file, std::true_type, axis_t... axes)
+{
+	return table_t(std::move(axes)..., data, file);
+}
+template<typename table_t, typename... axis_t>
+table_t binary_intern_table(double const * data, size_t N, std::shared_ptr<void const> const &, std::false_type, axis_t... axes)
+{
+	std::unique_ptr<typename table_t::value_type[]> values(new typename table_t::value_type[N]);
+	std::copy(data, data + N, values.get());
+	return table_t(std::move(axes)..., std::move(values));
+}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material<intern_real_type, fast_real_type> basic_material<intern_real_type, fast_real_type>::load_binary(std::string const & filename, bool verify_checksum)
+{
+	using format = binary_material_format;
+	using section_t = format::section_t;
+
+	std::shared_ptr<binary_material_file> file = std::make_shared<binary_material_file>(filename, verify_checksum);
+	auto find_section = [&file, &filename](uint32_t type, uint32_t id, uint64_t expected_size) -> section_t const &
+	{
+		section_t const * section = file->find_section(type, id);
+		if (section == nullptr)
+			throw std::runtime_error("Section missing in binary material file " + filename);
+		if (expected_size != 0 && section->size != expected_size)
+			throw std::runtime_error("Section has unexpected size in binary material file " + filename);
+		return *section;
+	};
+
+	basic_material result;
+	result.source_filename = filename;
+	result.binary_file = file;
+
+	section_t const & name_section = find_section(format::SEC_NAME, 0, 0);
+	result.name.assign(static_cast<char const *>(file->get_data(name_section)), name_section.size);
+
+	section_t const & property_section = find_section(format::SEC_PROPERTIES, 0, BPROP_COUNT * sizeof(format::property_t));
+	format::property_t const * properties = static_cast<format::property_t const *>(file->get_data(property_section));
+	result.conductor_type = static_cast<conductor_type_t>(properties[BPROP_CONDUCTOR_TYPE].value);
+	result.fermi = quantity_cast<intern_real>(from_binary_property(properties[BPROP_FERMI]));
+	result.density = quantity_cast<intern_real>(from_binary_property(properties[BPROP_DENSITY]));
+	result.phonon_loss = quantity_cast<intern_real>(from_binary_property(properties[BPROP_PHONON_LOSS]));
+	result.barrier = quantity_cast<intern_real>(from_binary_property(properties[BPROP_BARRIER]));
+	result.effective_A = quantity_cast<intern_real>(from_binary_property(properties[BPROP_EFFECTIVE_A]));
+	result.band_gap = quantity_cast<intern_real>(from_binary_property(properties[BPROP_BAND_GAP]));
+
+	// Energy axes are stored with every table. Tables on the same grid share
+	// one axis, see ax_list.
+	std::vector<ax_list<intern_real>> energy_axes;
+	auto energy_axis = [&energy_axes](double const * data, uint64_t N) -> ax_list<intern_real>
+	{
+		for (ax_list<intern_real> const & axis : energy_axes)
+		{
+			if (axis.size() == N && std::equal(axis.begin(), axis.end(), data,
+				[](intern_real a, double b) { return a == static_cast<intern_real>(b); }))
+			{
+				return axis;
+			}
+		}
+		energy_axes.push_back(std::vector<intern_real>(data, data + N));
+		return energy_axes.back();
+	};
+
+	// Intern tables are stored as doubles. Double precision tables refer to the
+	// mapped file, only the energy axes are copied. Other precisions are converted.
+	using is_double = std::is_same<intern_real, double>;
+	auto read_1D = [&](uint32_t id) -> intern_table1D_t
+	{
+		section_t const * section = file->find_section(format::SEC_INTERN_1D, id);
+		const uint64_t N = (section ? section->N[0] : 0);
+		find_section(format::SEC_INTERN_1D, id, 2 * N * sizeof(double));
+		double* data = static_cast<double*>(file->get_data(*section));
+		return binary_intern_table<intern_table1D_t>(data + N, N, file, is_double(),
+			energy_axis(data, N));
+	};
+	auto read_2D = [&](uint32_t id) -> intern_table2D_t
+	{
+		section_t const * section = file->find_section(format::SEC_INTERN_2D, id);
+		const uint64_t N_K = (section ? section->N[0] : 0);
+		const uint64_t N_P = (section ? section->N[1] : 0);
+		find_section(format::SEC_INTERN_2D, id, (N_K + N_K * N_P) * sizeof(double));
+		double* data = static_cast<double*>(file->get_data(*section));
+		return binary_intern_table<intern_table2D_t>(data + N_K, N_K * N_P, file, is_double(),
+			energy_axis(data, N_K), ax_linspace<intern_real>(0, 1, N_P));
+	};
+
+	result.options.processes = 0;
+	if (file->find_section(format::SEC_INTERN_1D, TBL_ELASTIC_IMFP) != nullptr)
+	{
+		result.elastic_cross_section = read_1D(TBL_ELASTIC_IMFP);
+		result.elastic_angle_icdf = read_2D(TBL_ELASTIC_ANGLE_ICDF);
+		result.options.processes |= PROC_ELASTIC;
+	}
+	if (file->find_section(format::SEC_INTERN_1D, TBL_INELASTIC_IMFP) != nullptr)
+	{
+		result.inelastic_cross_section = read_1D(TBL_INELASTIC_IMFP);
+		result.inelastic_w0_icdf = read_2D(TBL_INELASTIC_W0_ICDF);
+		result.options.processes |= PROC_INELASTIC;
+	}
+	if (file->find_section(format::SEC_INTERN_2D, TBL_IONIZATION_ICDF) != nullptr)
+	{
+		result.ionization_dE_icdf = read_2D(TBL_IONIZATION_ICDF);
+		section_t const * section = file->find_section(format::SEC_OUTER_SHELLS, 0);
+		const uint64_t N = (section ? section->N[0] : 0);
+		find_section(format::SEC_OUTER_SHELLS, 0, N * sizeof(double));
+		double const * data = static_cast<double const *>(file->get_data(*section));
+		result.outer_shells.assign(data, data + N);
+		result.options.processes |= PROC_IONIZATION;
+	}
+	if (file->find_section(format::SEC_INTERN_1D, TBL_ELECTRON_RANGE) != nullptr)
+	{
+		result.electron_range = read_1D(TBL_ELECTRON_RANGE);
+		result.options.processes |= PROC_ELECTRON_RANGE;
+	}
+
+	return result;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::find_prebuilt(table_kind_t kind, fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> fast_real*
+{
+	if (binary_file == nullptr)
+		return nullptr;
+
+	for (binary_material_format::section_t const & section : binary_file->get_sections())
+	{
+		if (section.type == binary_material_format::SEC_FAST_TABLE
+			&& section.id == static_cast<uint32_t>(kind)
+			&& section.value_size == sizeof(fast_real)
+			&& section.K_range[0] == K_min && section.K_range[1] == K_max
+			&& section.N[0] == N_K && section.N[1] == N_P
+			&& section.size == N_K * N_P * sizeof(fast_real))
+		{
+			return static_cast<fast_real*>(binary_file->get_data(section));
+		}
+	}
+	return nullptr;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+std::string basic_material<intern_real_type, fast_real_type>::get_name() const
+{
+	return name;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_conductor_type() const -> conductor_type_t
+{
+	return conductor_type;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_fermi() const -> quantity<intern_real>
+{
+	return fermi;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_density() const -> quantity<intern_real>
+{
+	return density;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_phonon_loss() const -> quantity<intern_real>
+{
+	return phonon_loss;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_effective_A() const -> quantity<intern_real>
+{
+	return effective_A;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_barrier() const -> quantity<intern_real>
+{
+	return barrier;
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_band_gap() const -> quantity<intern_real>
+{
+	return band_gap;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> imfp_table_t
+{
+	return to_fast_table(TBL_ELASTIC_IMFP, elastic_cross_section, ax_logspace<fast_real>(K_min, K_max, N),
+		axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ get_density().value });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> icdf_table_t
+{
+	return to_fast_table(TBL_ELASTIC_ANGLE_ICDF, elastic_angle_icdf, ax_logspace<fast_real>(K_min, K_max, N_K),
+		axis_key_t{ K_min, K_max, 0 }, N_P, linear_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> imfp_table_t
+{
+	return to_fast_table(TBL_INELASTIC_IMFP, inelastic_cross_section, ax_logspace<fast_real>(K_min, K_max, N),
+		axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ get_density().value });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> icdf_table_t
+{
+	return to_fast_table(TBL_INELASTIC_W0_ICDF, inelastic_w0_icdf, ax_logspace<fast_real>(K_min, K_max, N_K),
+		axis_key_t{ K_min, K_max, 0 }, N_P, linear_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> ionization_table_t
+{
+	return to_fast_table(TBL_IONIZATION_ICDF, ionization_dE_icdf, ax_logspace<fast_real>(K_min, K_max, N_K),
+		axis_key_t{ K_min, K_max, 0 }, N_P, binding_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_electron_range(fast_real K_min, fast_real K_max, size_t N) const -> range_table_t
+{
+	return to_fast_table(TBL_ELECTRON_RANGE, electron_range, ax_logspace<fast_real>(K_min, K_max, N),
+		axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ 1 });
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_imfp(piecewise_axis_t const & K_axis) const -> piecewise_imfp_table_t
+{
+	return to_fast_table(TBL_ELASTIC_IMFP, elastic_cross_section, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, log_loglog_conversion<intern_real, fast_real>{ get_density().value });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_angle_icdf(piecewise_axis_t const & K_axis, size_t N_P) const -> piecewise_icdf_table_t
+{
+	return to_fast_table(TBL_ELASTIC_ANGLE_ICDF, elastic_angle_icdf, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, N_P, linear_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_imfp(piecewise_axis_t const & K_axis) const -> piecewise_imfp_table_t
+{
+	return to_fast_table(TBL_INELASTIC_IMFP, inelastic_cross_section, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, log_loglog_conversion<intern_real, fast_real>{ get_density().value });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_w0_icdf(piecewise_axis_t const & K_axis, size_t N_P) const -> piecewise_icdf_table_t
+{
+	return to_fast_table(TBL_INELASTIC_W0_ICDF, inelastic_w0_icdf, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, N_P, linear_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_ionization_icdf(piecewise_axis_t const & K_axis, size_t N_P) const -> piecewise_ionization_table_t
+{
+	return to_fast_table(TBL_IONIZATION_ICDF, ionization_dE_icdf, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, N_P, binding_conversion<intern_real, fast_real>());
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_electron_range(piecewise_axis_t const & K_axis) const -> piecewise_range_table_t
+{
+	return to_fast_table(TBL_ELECTRON_RANGE, electron_range, K_axis,
+		axis_key_t{ K_axis.get_edges().front(), K_axis.get_edges().back(), axis_hash(K_axis) }, log_loglog_conversion<intern_real, fast_real>{ 1 });
+}
+
+// The native table is only needed to compute the differences.
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+	table_encoding::slope) const -> slope_imfp_table_t
+{
+	return slope_imfp_table_t(get_elastic_imfp(K_min, K_max, N));
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+	table_encoding::slope) const -> slope_icdf_table_t
+{
+	return slope_icdf_table_t(get_elastic_angle_icdf(K_min, K_max, N_K, N_P));
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+	table_encoding::slope) const -> slope_imfp_table_t
+{
+	return slope_imfp_table_t(get_inelastic_imfp(K_min, K_max, N));
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+	table_encoding::slope) const -> slope_icdf_table_t
+{
+	return slope_icdf_table_t(get_inelastic_w0_icdf(K_min, K_max, N_K, N_P));
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_electron_range(fast_real K_min, fast_real K_max, size_t N,
+	table_encoding::slope) const -> slope_range_table_t
+{
+	return slope_range_table_t(get_electron_range(K_min, K_max, N));
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_outer_shells() const -> outer_shell_table_t
+{
+	require(PROC_IONIZATION);
+	std::vector<fast_real> return_vector(outer_shells.size());
+	for (size_t i = 0; i < outer_shells.size(); ++i)
+		return_vector[i] = (fast_real)outer_shells[i];
+	return return_vector;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_imfp(fast_real K_min, fast_real K_max,
+	accuracy_target const & target, accuracy_report* report) const -> imfp_table_t
+{
+	require(PROC_ELASTIC);
+	const accuracy_report sized = size_loglog_table(elastic_cross_section, get_density().value, K_min, K_max, target);
+	if (report != nullptr)
+		*report = sized;
+	return get_elastic_imfp(K_min, K_max, sized.N_K);
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_angle_icdf(fast_real K_min, fast_real K_max,
+	accuracy_target const & target, accuracy_report* report) const -> icdf_table_t
+{
+	require(PROC_ELASTIC);
+	const accuracy_report sized = size_icdf_table(elastic_angle_icdf, K_min, K_max, target);
+	if (report != nullptr)
+		*report = sized;
+	return get_elastic_angle_icdf(K_min, K_max, sized.N_K, sized.N_P);
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_imfp(fast_real K_min, fast_real K_max,
+	accuracy_target const & target, accuracy_report* report) const -> imfp_table_t
+{
+	require(PROC_INELASTIC);
+	const accuracy_report sized = size_loglog_table(inelastic_cross_section, get_density().value, K_min, K_max, target);
+	if (report != nullptr)
+		*report = sized;
+	return get_inelastic_imfp(K_min, K_max, sized.N_K);
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_w0_icdf(fast_real K_min, fast_real K_max,
+	accuracy_target const & target, accuracy_report* report) const -> icdf_table_t
+{
+	require(PROC_INELASTIC);
+	const accuracy_report sized = size_icdf_table(inelastic_w0_icdf, K_min, K_max, target);
+	if (report != nullptr)
+		*report = sized;
+	return get_inelastic_w0_icdf(K_min, K_max, sized.N_K, sized.N_P);
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_electron_range(fast_real K_min, fast_real K_max,
+	accuracy_target const & target, accuracy_report* report) const -> range_table_t
+{
+	require(PROC_ELECTRON_RANGE);
+	const accuracy_report sized = size_loglog_table(electron_range, 1, K_min, K_max, target);
+	if (report != nullptr)
+		*report = sized;
+	return get_electron_range(K_min, K_max, sized.N_K);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_elastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> std::shared_ptr<imfp_table_t const>
+{
+	return get_shared<imfp_table_t>(TBL_ELASTIC_IMFP, K_min, K_max, N, 1,
+		[&]() { return get_elastic_imfp(K_min, K_max, N); });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> std::shared_ptr<icdf_table_t const>
+{
+	return get_shared<icdf_table_t>(TBL_ELASTIC_ANGLE_ICDF, K_min, K_max, N_K, N_P,
+		[&]() { return get_elastic_angle_icdf(K_min, K_max, N_K, N_P); });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N) const -> std::shared_ptr<imfp_table_t const>
+{
+	return get_shared<imfp_table_t>(TBL_INELASTIC_IMFP, K_min, K_max, N, 1,
+		[&]() { return get_inelastic_imfp(K_min, K_max, N); });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> std::shared_ptr<icdf_table_t const>
+{
+	return get_shared<icdf_table_t>(TBL_INELASTIC_W0_ICDF, K_min, K_max, N_K, N_P,
+		[&]() { return get_inelastic_w0_icdf(K_min, K_max, N_K, N_P); });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const -> std::shared_ptr<ionization_table_t const>
+{
+	return get_shared<ionization_table_t>(TBL_IONIZATION_ICDF, K_min, K_max, N_K, N_P,
+		[&]() { return get_ionization_icdf(K_min, K_max, N_K, N_P); });
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_shared_electron_range(fast_real K_min, fast_real K_max, size_t N) const -> std::shared_ptr<range_table_t const>
+{
+	return get_shared<range_table_t>(TBL_ELECTRON_RANGE, K_min, K_max, N, 1,
+		[&]() { return get_electron_range(K_min, K_max, N); });
+}
+
+template<typename intern_real_type, typename fast_real_type>
+template<typename table_t, typename build_func>
+progressive_table<table_t> basic_material<intern_real_type, fast_real_type>::make_progressive(process_t process,
+	size_t N_K, size_t N_K_coarse, build_func build) const
+{
+	if (N_K <= N_K_coarse)
+		return progressive_table<table_t>(build(*this, N_K, true));
+
+	table_t coarse = build(*this, N_K_coarse, false);
+	std::shared_ptr<basic_material> source(new basic_material);
+	source->copy_from(*this, process);
+	source->options.processes = process;
+	return progressive_table<table_t>(std::move(coarse), [source, build, N_K]() { return build(*source, N_K, true); });
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_elastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+	size_t N_K_coarse) const -> progressive_table<imfp_table_t>
+{
+	return make_progressive<imfp_table_t>(PROC_ELASTIC, N, N_K_coarse,
+		[K_min, K_max](basic_material const & source, size_t N_K, bool stored)
+		{
+			return source.to_fast_table(TBL_ELASTIC_IMFP, source.elastic_cross_section, ax_logspace<fast_real>(K_min, K_max, N_K),
+				axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ source.get_density().value }, stored);
+		});
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+	size_t N_K_coarse) const -> progressive_table<icdf_table_t>
+{
+	return make_progressive<icdf_table_t>(PROC_ELASTIC, N_K, N_K_coarse,
+		[K_min, K_max, N_P](basic_material const & source, size_t N, bool stored)
+		{
+			return source.to_fast_table(TBL_ELASTIC_ANGLE_ICDF, source.elastic_angle_icdf, ax_logspace<fast_real>(K_min, K_max, N),
+				axis_key_t{ K_min, K_max, 0 }, N_P, linear_conversion<intern_real, fast_real>(), stored);
+		});
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+	size_t N_K_coarse) const -> progressive_table<imfp_table_t>
+{
+	return make_progressive<imfp_table_t>(PROC_INELASTIC, N, N_K_coarse,
+		[K_min, K_max](basic_material const & source, size_t N_K, bool stored)
+		{
+			return source.to_fast_table(TBL_INELASTIC_IMFP, source.inelastic_cross_section, ax_logspace<fast_real>(K_min, K_max, N_K),
+				axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ source.get_density().value }, stored);
+		});
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+	size_t N_K_coarse) const -> progressive_table<icdf_table_t>
+{
+	return make_progressive<icdf_table_t>(PROC_INELASTIC, N_K, N_K_coarse,
+		[K_min, K_max, N_P](basic_material const & source, size_t N, bool stored)
+		{
+			return source.to_fast_table(TBL_INELASTIC_W0_ICDF, source.inelastic_w0_icdf, ax_logspace<fast_real>(K_min, K_max, N),
+				axis_key_t{ K_min, K_max, 0 }, N_P, linear_conversion<intern_real, fast_real>(), stored);
+		});
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+	size_t N_K_coarse) const -> progressive_table<ionization_table_t>
+{
+	return make_progressive<ionization_table_t>(PROC_IONIZATION, N_K, N_K_coarse,
+		[K_min, K_max, N_P](basic_material const & source, size_t N, bool stored)
+		{
+			return source.to_fast_table(TBL_IONIZATION_ICDF, source.ionization_dE_icdf, ax_logspace<fast_real>(K_min, K_max, N),
+				axis_key_t{ K_min, K_max, 0 }, N_P, binding_conversion<intern_real, fast_real>(), stored);
+		});
+}
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_progressive_electron_range(fast_real K_min, fast_real K_max, size_t N,
+	size_t N_K_coarse) const -> progressive_table<range_table_t>
+{
+	return make_progressive<range_table_t>(PROC_ELECTRON_RANGE, N, N_K_coarse,
+		[K_min, K_max](basic_material const & source, size_t N_K, bool stored)
+		{
+			return source.to_fast_table(TBL_ELECTRON_RANGE, source.electron_range, ax_logspace<fast_real>(K_min, K_max, N_K),
+				axis_key_t{ K_min, K_max, 0 }, log_loglog_conversion<intern_real, fast_real>{ 1 }, stored);
+		});
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_elastic_energy_range() const -> std::pair<intern_real, intern_real>
+{
+	require(PROC_ELASTIC);
+	// Note: the energy axis is shared between the cross section and icdf tables.
+	return elastic_cross_section.get_xrange();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_inelastic_energy_range() const -> std::pair<intern_real, intern_real>
+{
+	require(PROC_INELASTIC);
+	// Note: the energy axis is shared between the cross section and icdf tables.
+	return inelastic_cross_section.get_xrange();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_ionization_energy_range() const -> std::pair<intern_real, intern_real>
+{
+	require(PROC_IONIZATION);
+	return ionization_dE_icdf.get_xrange();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_electron_range_energy_range() const -> std::pair<intern_real, intern_real>
+{
+	require(PROC_ELECTRON_RANGE);
+	return electron_range.get_xrange();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::require(process_t process) const
+{
+	if (!(options.processes & process))
+		throw std::runtime_error("Material " + name + ": requested tables for a process that was not loaded.");
+	if (released)
+		throw std::runtime_error("Material " + name + ": tables were requested after release_source_tables().");
+
+	if (loader == nullptr || !(loader->pending.load(std::memory_order_acquire) & process))
+		return;
+
+	std::lock_guard<std::mutex> guard(loader->mutex);
+	const unsigned int pending = loader->pending.load(std::memory_order_relaxed);
+	if (!(pending & process))
+		return; // Another thread got here first.
+
+	try
+	{
+		auto lock = h5_lock();
+		process_io_counter counter(io_stats, loader->image == nullptr && !source_filename.empty());
+		read_process(*loader->file, process);
+
+		// Close the file as soon as we are done with it
+		if ((pending & ~process) == 0)
+		{
+			loader->file.reset();
+			loader->image.reset();
+			loader->buffer.reset();
+		}
+	}
+	catch (H5::Exception const & error)
+	{
+		throw std::runtime_error("Error encountered while reading HDF5 file: " + error.getDetailMsg());
+	}
+	loader->pending.store(pending & ~process, std::memory_order_release);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+void basic_material<intern_real_type, fast_real_type>::read_process(H5::H5File const & file, process_t process) const
+{
+	switch (process)
+	{
+	case PROC_ELASTIC:
+		std::tie(elastic_cross_section, elastic_angle_icdf) = read_elastic<intern_real>(file.openGroup("elastic"), options.energy_window);
+		break;
+	case PROC_INELASTIC:
+		std::tie(inelastic_cross_section, inelastic_w0_icdf) = read_inelastic<intern_real>(file.openGroup("inelastic"), options.energy_window);
+		break;
+	case PROC_IONIZATION:
+	{
+		const H5::Group ionization_group = file.openGroup("ionization");
+		ionization_dE_icdf = read_ionization<intern_real>(ionization_group, options.energy_window);
+		outer_shells = read_outer_shells<intern_real>(ionization_group);
+		break;
+	}
+	case PROC_ELECTRON_RANGE:
+		electron_range = read_electron_range<intern_real>(file.openGroup("electron_range"), options.energy_window);
+		break;
+	default:
+		throw std::runtime_error("Unknown process.");
+	}
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material<intern_real_type, fast_real_type>::get_process(table_kind_t kind) -> process_t
+{
+	switch (kind)
+	{
+	case TBL_ELASTIC_IMFP:
+	case TBL_ELASTIC_ANGLE_ICDF:
+		return PROC_ELASTIC;
+	case TBL_INELASTIC_IMFP:
+	case TBL_INELASTIC_W0_ICDF:
+		return PROC_INELASTIC;
+	case TBL_IONIZATION_ICDF:
+		return PROC_IONIZATION;
+	case TBL_ELECTRON_RANGE:
+		return PROC_ELECTRON_RANGE;
+	}
+	throw std::runtime_error("Unknown table kind.");
+}
+
+template<typename intern_real_type, typename fast_real_type>
+template<typename table_t, typename build_func>
+auto basic_material<intern_real_type, fast_real_type>::get_shared(table_kind_t kind, fast_real K_min, fast_real K_max,
+	size_t N_K, size_t N_P, build_func build) const -> std::shared_ptr<table_t const>
+{
+	const typename shared_tables_t::key_t key(kind, K_min, K_max, N_K, N_P);
+
+	// Claim the table, or find the thread that did.
+	std::promise<std::shared_ptr<void const>> promise;
+	std::shared_future<std::shared_ptr<void const>> future;
+	bool claimed = false;
+	{
+		std::lock_guard<std::mutex> guard(shared_fast_tables->mutex);
+		auto it = shared_fast_tables->tables.find(key);
+		if (it == shared_fast_tables->tables.end())
+		{
+			future = promise.get_future().share();
+			shared_fast_tables->tables.emplace(key, future);
+			claimed = true;
+		}
+		else
+		{
+			future = it->second;
+		}
+	}
+
+	if (claimed)
+	{
+		try
+		{
+			promise.set_value(std::make_shared<table_t const>(build()));
+		}
+		catch (...)
+		{
+			// Forget about this table, so that the next call tries again.
+			{
+				std::lock_guard<std::mutex> guard(shared_fast_tables->mutex);
+				shared_fast_tables->tables.erase(key);
+			}
+			promise.set_exception(std::current_exception());
+		}
+	}
+
+	return std::static_pointer_cast<table_t const>(future.get());
+}
+
+template<typename intern_real_type, typename fast_real_type>
+template<typename energy_axis_t, typename conversion_func>
+auto basic_material<intern_real_type, fast_real_type>::to_fast_table(table_kind_t kind, intern_table1D_t const & intern,
+	energy_axis_t const & K_axis, axis_key_t const & axis_key, conversion_func f, bool stored) const -> fast_table1D_t<energy_axis_t>
+{
+	const size_t N = K_axis.size();
+
+	// Prebuilt in the binary file we were loaded from? Only on ax_logspace.
+	if (axis_key.hash == 0)
+	{
+		if (fast_real* prebuilt = find_prebuilt(kind, axis_key.K_min, axis_key.K_max, N, 1))
+			return{ K_axis, prebuilt, binary_file };
+	}
+
+	// Fill values from the cache if possible, build them otherwise
+	const table_cache::key_t key{ table_source_hash<intern_real>(source_hash, options.energy_window, axis_key.hash), kind, sizeof(fast_real),
+		axis_key.K_min, axis_key.K_max, N, 1 };
+	auto fill = [&](fast_real* values)
+	{
+		if (stored && cache && cache->load(key, values, N))
+			return;
+
+		require(get_process(kind));
+
+		// Sweep through the intern energy axis, see ax_list::find.
+		parallel_blocks(N, build_threads, [&](size_t begin, size_t end)
+		{
+			size_t hint = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const intern_real K = K_axis[i];
+				values[i] = f(intern, K, intern.find_index(K, hint));
+			}
+		});
+
+		if (stored && cache)
+			cache->store(key, values, N);
+	};
+
+	// Shared with other processes?
+	if (stored && shared_tables)
+	{
+		std::shared_ptr<void const> segment;
+		void const * shared = shared_tables->get(key, N,
+			[&fill](void* data) { fill(static_cast<fast_real*>(data)); }, segment);
+		// Read-only mapping; fast tables are never written to.
+		if (shared != nullptr)
+			return{ K_axis, const_cast<fast_real*>(static_cast<fast_real const *>(shared)), std::move(segment) };
+	}
+
+	std::unique_ptr<fast_real[]> values(new fast_real[N]);
+	fill(values.get());
+	return{ K_axis, std::move(values) };
+}
+
+template<typename intern_real_type, typename fast_real_type>
+template<typename energy_axis_t, typename conversion_func>
+auto basic_material<intern_real_type, fast_real_type>::to_fast_table(table_kind_t kind, intern_table2D_t const & intern,
+	energy_axis_t const & K_axis, axis_key_t const & axis_key, size_t N_P, conversion_func f, bool stored) const -> fast_table2D_t<energy_axis_t>
+{
+	const size_t N_K = K_axis.size();
+	// Probability axis
+	ax_unit_interval<fast_real> P_axis(N_P);
+
+	// Prebuilt in the binary file we were loaded from? Only on ax_logspace.
+	if (axis_key.hash == 0)
+	{
+		if (fast_real* prebuilt = find_prebuilt(kind, axis_key.K_min, axis_key.K_max, N_K, N_P))
+			return{ K_axis, P_axis, prebuilt, binary_file };
+	}
+
+	// Fill values from the cache if possible, build them otherwise
+	const table_cache::key_t key{ table_source_hash<intern_real>(source_hash, options.energy_window, axis_key.hash), kind, sizeof(fast_real),
+		axis_key.K_min, axis_key.K_max, N_K, N_P };
+	auto fill = [&](fast_real* values)
+	{
+		if (stored && cache && cache->load(key, values, N_K*N_P))
+			return;
+
+		require(get_process(kind));
+
+		// The position of each P in the intern table is the same for all rows.
+		std::vector<intern_real> true_P(N_P);
+		size_t P_hint = 0;
 		for (size_t ip = 0; ip < N_P; ++ip)
 		{
-			values[ik*N_P + ip] = f(intern, K_axis[ik], P_axis[ip]);
+			true_P[ip] = intern.find_y(P_axis[ip], P_hint);
 		}
+
+		// Rows are independent, split them over threads. The inner loop does
+		// no searches, only the interpolation in the intern table.
+		// Each block sweeps through the intern energy axis, see ax_list::find.
+		const row_converter<intern_table2D_t, conversion_func> convert(intern, true_P, f);
+		parallel_blocks(N_K, build_threads, [&](size_t begin, size_t end)
+		{
+			size_t K_hint = 0;
+			for (size_t ik = begin; ik < end; ++ik)
+			{
+				const intern_real true_K = intern.find_x(K_axis[ik], K_hint);
+				convert.fill_row(true_K, values + ik*N_P);
+			}
+		});
+
+		if (stored && cache)
+			cache->store(key, values, N_K*N_P);
+	};
+
+	// Shared with other processes?
+	if (stored && shared_tables)
+	{
+		std::shared_ptr<void const> segment;
+		void const * shared = shared_tables->get(key, N_K*N_P,
+			[&fill](void* data) { fill(static_cast<fast_real*>(data)); }, segment);
+		// Read-only mapping; fast tables are never written to.
+		if (shared != nullptr)
+			return{ K_axis, P_axis, const_cast<fast_real*>(static_cast<fast_real const *>(shared)), std::move(segment) };
 	}
 
-	return{ K_axis, P_axis, values };
+	std::unique_ptr<fast_real[]> values(new fast_real[N_K*N_P]);
+	fill(values.get());
+	return{ K_axis, P_axis, std::move(values) };
 }
+
+// Precisions available, see material.h.
+template class basic_material<double, float>;
+template class basic_material<double, double>;
+template class basic_material<float, float>;
@@ -14,21 +14,145 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
 #include "imfp_table.h"
 #include "icdf_table.h"
+#include "file_image.h"
 #include "ionization_table.h"
+#include "progressive_table.h"
 #include "table/array1D_ax.h"
 #include "table/array2D_ax.h"
 #include "table/ax_list.h"
 #include "table/ax_linspace.h"
 #include "table/ax_logspace.h"
+#include "table/ax_piecewise_logspace.h"
+#include "table/ax_unit_interval.h"
 #include "units/quantity.h"
 
-class material
+class table_cache;
+class shared_table_store;
+class binary_material_file;
+namespace H5 { class H5File; }
+
+// Types that do not depend on the precision, shared by all basic_material types.
+class material_base
+{
+public:
+	// Different types of conductor
+	enum conductor_type_t
+	{
+		CND_METAL,
+		CND_SEMICONDUCTOR,
+		CND_INSULATOR
+	};
+
+	// Physical processes, used to select which parts of the file are read.
+	enum process_t
+	{
+		PROC_ELASTIC        = 1 << 0,
+		PROC_INELASTIC      = 1 << 1,
+		PROC_IONIZATION     = 1 << 2,
+		PROC_ELECTRON_RANGE = 1 << 3,
+		PROC_ALL = PROC_ELASTIC | PROC_INELASTIC | PROC_IONIZATION | PROC_ELECTRON_RANGE
+	};
+
+	// How HDF5 files are read, see file_image.h.
+	enum io_strategy_t
+	{
+		IO_HDF5,       // HDF5's own file driver, many small reads
+		IO_READ_WHOLE, // Read the whole file in one go, serve HDF5 from memory
+		IO_MMAP        // Memory map the file, serve HDF5 from memory
+	};
+
+	// Identifies the fast tables built by the get_* functions.
+	// These values are stored in cache and binary files, do not change them.
+	enum table_kind_t
+	{
+		TBL_ELASTIC_IMFP,
+		TBL_ELASTIC_ANGLE_ICDF,
+		TBL_INELASTIC_IMFP,
+		TBL_INELASTIC_W0_ICDF,
+		TBL_IONIZATION_ICDF,
+		TBL_ELECTRON_RANGE
+	};
+
+	// Accuracy requirement for fast tables that are sized automatically.
+	// The error is the largest difference between a fast table and the intern
+	// tables, at the intern grid points and halfway between fast grid points.
+	// The relative error is taken with respect to the intern value, or is the
+	// absolute error where that is zero.
+	struct accuracy_target
+	{
+		double max_error;
+		bool relative = true; // Absolute errors are in the units of the table
+	};
+
+	// Grid size chosen for an accuracy_target, and the error it achieves.
+	struct accuracy_report
+	{
+		size_t N_K = 0;
+		size_t N_P = 1;       // 1 for 1D tables
+		double max_error = 0; // Relative or absolute, as requested
+		bool met = false;     // False if the largest allowed grid was not enough
+	};
+
+	// Memory held by one intern table, see memory_usage().
+	struct table_memory
+	{
+		table_kind_t kind;   // The fast tables built from this intern table
+		size_t heap_bytes;   // Values and axes in memory allocated for this table
+		size_t mapped_bytes; // Values that refer to a binary file, see load_binary
+	};
+
+	// Memory held by the intern tables of a material. Fast tables are not
+	// included, they belong to the caller.
+	struct memory_report
+	{
+		std::vector<table_memory> tables; // Tables that are loaded
+		size_t outer_shell_bytes = 0;
+		size_t source_image_bytes = 0;    // Copy of a file image, while tables are still to be read from it
+		size_t heap_bytes = 0;            // Total of all of the above
+	};
+
+	// Options for loading a material from file.
+	struct load_options
+	{
+		// Bitwise OR of process_t values.
+		// Tables for other processes are never read, requesting them throws std::runtime_error.
+		unsigned int processes = PROC_ALL;
+
+		// If true, the tables for a process are read when they are first needed,
+		// instead of in the constructor. The file is kept open until then.
+		bool lazy = false;
+
+		// Energy range (in eV) for which tables are needed. Only this part of the
+		// tables is read, plus one point on either side for interpolation.
+		// Fast tables extending beyond this range are extrapolated.
+		std::pair<double, double> energy_window{ 0, std::numeric_limits<double>::infinity() };
+
+		// For IO_READ_WHOLE and IO_MMAP, the file contents are kept in memory
+		// until all tables have been read, see lazy.
+		io_strategy_t io_strategy = IO_HDF5;
+	};
+};
+
+/*
+ * Material with intern tables (as read from file) in intern_real_type and fast
+ * tables (built by the get_* functions) in fast_real_type. Instantiated in
+ * material.cpp for <double, float>, the default; <double, double>, to validate
+ * simulations against double precision fast tables; and <float, float>, which
+ * halves the memory taken by the intern tables.
+ */
+template<typename intern_real_type = double, typename fast_real_type = float>
+class basic_material : public material_base
 {
 public:
-	using intern_real = double;
-	using fast_real = float;
+	using intern_real = intern_real_type;
+	using fast_real = fast_real_type;
 
 	using imfp_table_t = imfp_table<fast_real>;
 	using icdf_table_t = icdf_table<fast_real>;
@@ -36,17 +160,98 @@ public:
 	using outer_shell_table_t = std::vector<fast_real>;
 	using range_table_t = imfp_table<fast_real>;
 
-	// Different types of conductor
-	enum conductor_type_t
+	// Fast tables on a piecewise energy axis, see table/ax_piecewise_logspace.h.
+	using piecewise_axis_t = ax_piecewise_logspace<fast_real>;
+	using piecewise_imfp_table_t = imfp_table<fast_real, table_encoding::native, piecewise_axis_t>;
+	using piecewise_icdf_table_t = icdf_table<fast_real, table_encoding::native, piecewise_axis_t>;
+	using piecewise_ionization_table_t = ionization_table<fast_real, table_encoding::native, piecewise_axis_t>;
+	using piecewise_range_table_t = imfp_table<fast_real, table_encoding::native, piecewise_axis_t>;
+
+	// Fast tables stored as (value, difference) pairs, see table/table_encoding.h.
+	using slope_imfp_table_t = imfp_table<fast_real, table_encoding::slope>;
+	using slope_icdf_table_t = icdf_table<fast_real, table_encoding::slope>;
+	using slope_range_table_t = imfp_table<fast_real, table_encoding::slope>;
+
+	// Parameters for building a fast table. N_P is ignored for 1D tables.
+	struct fast_table_spec
 	{
-		CND_METAL,
-		CND_SEMICONDUCTOR,
-		CND_INSULATOR
+		table_kind_t kind;
+		fast_real K_min;
+		fast_real K_max;
+		size_t N_K;
+		size_t N_P;
 	};
 
 	// Load material from hdf5 file.
+	// May throw std::runtime_error exceptions, also from the getters below if loading lazily.
+	basic_material(std::string const & filename);
+	basic_material(std::string const & filename, load_options const & options);
+
+	// Load material from an hdf5 file image in memory, e.g. a file staged into
+	// RAM by the job launcher. No files are accessed. The buffer is copied, it
+	// need not remain valid after the constructor returns. The copy is freed once
+	// all tables have been read from it: when the constructor returns, or when
+	// loading lazily, once the last process is loaded or release_source_tables()
+	// is called.
+	// May throw std::runtime_error exceptions, as above.
+	basic_material(void const * buffer, size_t size);
+	basic_material(void const * buffer, size_t size, load_options const & options);
+
+	~basic_material();
+	basic_material(basic_material &&);
+	basic_material& operator=(basic_material &&);
+	// Copies share the table cache, shared memory store and binary file, but
+	// not the tables handed out by the get_shared_* functions. A material that
+	// loads lazily first reads its remaining tables.
+	basic_material(basic_material const &);
+	basic_material& operator=(basic_material const &);
+
+	// Save in csread's binary format, see binary_material.h. The fast tables
+	// listed are built and stored too, so that they need not be built when loading.
 	// May throw std::runtime_error exceptions.
-	material(std::string const & filename);
+	void save_binary(std::string const & filename,
+		std::vector<fast_table_spec> const & fast_tables = std::vector<fast_table_spec>()) const;
+
+	// Load a material saved by save_binary. The file is memory mapped, tables
+	// refer to it directly instead of being read. Only the header and section
+	// table are checked; if verify_checksum is set, all data is also read once
+	// to check for corruption, which takes away the fast startup. Intern tables
+	// are stored in double precision; with float intern_real, they are
+	// converted instead.
+	// May throw std::runtime_error exceptions.
+	static basic_material load_binary(std::string const & filename, bool verify_checksum = false);
+
+	// I/O done for reading the HDF5 file so far, including lazily read tables.
+	// For IO_HDF5, this is measured with the counters of the whole process,
+	// so it includes I/O by other threads. Zero if those are not available.
+	io_statistics get_io_statistics() const;
+
+	// Keep the fast tables built by the get_* functions below in a persistent
+	// on-disk cache, see table_cache.h. The directory must exist.
+	// May throw std::runtime_error exceptions.
+	void set_table_cache(std::string const & directory);
+
+	// Share the fast tables built by the get_* functions below with other
+	// processes on this machine, through POSIX shared memory; see
+	// shared_table_store.h. Tables obtained this way are read-only.
+	// May throw std::runtime_error exceptions.
+	void set_shared_tables(std::string const & prefix);
+
+	// Number of threads used by the get_* functions below to build a fast
+	// table; zero for one per hardware thread. Defaults to one. The results
+	// do not depend on the number of threads.
+	void set_build_threads(unsigned int N_threads);
+
+	// Free the intern tables, which are only needed to build fast tables.
+	// Afterwards, the get_* functions only return fast tables that need not be
+	// built: those from get_shared_* built before, prebuilt tables in a binary
+	// file, and tables in the table cache or shared memory. Anything else,
+	// including the energy ranges and outer shells, throws std::runtime_error.
+	// Not thread-safe: no other calls on this material may be in progress.
+	void release_source_tables();
+
+	// Memory currently held by the intern tables.
+	memory_report memory_usage() const;
 
 	// Access some properties
 	std::string get_name() const;
@@ -68,6 +273,75 @@ public:
 	outer_shell_table_t get_outer_shells() const;
 	range_table_t get_electron_range(fast_real K_min, fast_real K_max, size_t N) const;
 
+	// Same as the above, on a piecewise energy axis with more points where the
+	// tables vary fastest. These are cached and shared like the above, but
+	// cannot be prebuilt in binary files.
+	piecewise_imfp_table_t get_elastic_imfp(piecewise_axis_t const & K_axis) const;
+	piecewise_icdf_table_t get_elastic_angle_icdf(piecewise_axis_t const & K_axis, size_t N_P) const;
+	piecewise_imfp_table_t get_inelastic_imfp(piecewise_axis_t const & K_axis) const;
+	piecewise_icdf_table_t get_inelastic_w0_icdf(piecewise_axis_t const & K_axis, size_t N_P) const;
+	piecewise_ionization_table_t get_ionization_icdf(piecewise_axis_t const & K_axis, size_t N_P) const;
+	piecewise_range_table_t get_electron_range(piecewise_axis_t const & K_axis) const;
+
+	// Same as the above, stored as (value, difference) pairs for faster
+	// interpolation. The values are those of the native tables, and come from
+	// the same cache, shared memory or binary file. The pairs are not shared.
+	// The native table is built first and freed afterwards: unless its values
+	// are in shared memory or the binary file, this takes three times the memory
+	// of the native table, for a result of twice that.
+	slope_imfp_table_t get_elastic_imfp(fast_real K_min, fast_real K_max, size_t N, table_encoding::slope) const;
+	slope_icdf_table_t get_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P, table_encoding::slope) const;
+	slope_imfp_table_t get_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N, table_encoding::slope) const;
+	slope_icdf_table_t get_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P, table_encoding::slope) const;
+	slope_range_table_t get_electron_range(fast_real K_min, fast_real K_max, size_t N, table_encoding::slope) const;
+
+	// Same as the above, with the smallest grid that meets an accuracy target.
+	// Grids are limited to 65536 points for 1D tables and 4096 by 4096 points for
+	// 2D tables; if that is not enough, the report says so. Finding the grid
+	// size takes a number of trial builds, so this is slower than the above.
+	// The ionization table is not interpolated, so it cannot be sized this way.
+	imfp_table_t get_elastic_imfp(fast_real K_min, fast_real K_max,
+		accuracy_target const & target, accuracy_report* report = nullptr) const;
+	icdf_table_t get_elastic_angle_icdf(fast_real K_min, fast_real K_max,
+		accuracy_target const & target, accuracy_report* report = nullptr) const;
+	imfp_table_t get_inelastic_imfp(fast_real K_min, fast_real K_max,
+		accuracy_target const & target, accuracy_report* report = nullptr) const;
+	icdf_table_t get_inelastic_w0_icdf(fast_real K_min, fast_real K_max,
+		accuracy_target const & target, accuracy_report* report = nullptr) const;
+	range_table_t get_electron_range(fast_real K_min, fast_real K_max,
+		accuracy_target const & target, accuracy_report* report = nullptr) const;
+
+	// Same as the above, but each table is built only once per material and then
+	// shared: later calls with the same parameters return the same table.
+	// Thread-safe; if several threads ask for a new table at the same time, one
+	// builds it and the others wait. If building fails, all of them get the
+	// exception and the next call tries again.
+	std::shared_ptr<imfp_table_t const> get_shared_elastic_imfp(fast_real K_min, fast_real K_max, size_t N) const;
+	std::shared_ptr<icdf_table_t const> get_shared_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const;
+	std::shared_ptr<imfp_table_t const> get_shared_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N) const;
+	std::shared_ptr<icdf_table_t const> get_shared_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const;
+	std::shared_ptr<ionization_table_t const> get_shared_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const;
+	std::shared_ptr<range_table_t const> get_shared_electron_range(fast_real K_min, fast_real K_max, size_t N) const;
+
+	// Same as the above, but only a coarse table with N_K_coarse energies is built
+	// before returning. The requested table is built on a background thread and
+	// replaces the coarse one when ready, see progressive_table.h. It is built
+	// from a private copy of the intern tables for its process, so the material
+	// need not outlive the handle. If N_K <= N_K_coarse, the requested table is
+	// built right away.
+	progressive_table<imfp_table_t> get_progressive_elastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+		size_t N_K_coarse = 64) const;
+	progressive_table<icdf_table_t> get_progressive_elastic_angle_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+		size_t N_K_coarse = 64) const;
+	progressive_table<imfp_table_t> get_progressive_inelastic_imfp(fast_real K_min, fast_real K_max, size_t N,
+		size_t N_K_coarse = 64) const;
+	progressive_table<icdf_table_t> get_progressive_inelastic_w0_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+		size_t N_K_coarse = 64) const;
+	progressive_table<ionization_table_t> get_progressive_ionization_icdf(fast_real K_min, fast_real K_max, size_t N_K, size_t N_P,
+		size_t N_K_coarse = 64) const;
+	progressive_table<range_table_t> get_progressive_electron_range(fast_real K_min, fast_real K_max, size_t N,
+		size_t N_K_coarse = 64) const;
+
 	// Get energy range. Units are as defined in unit_system.h, which is eV.
 	std::pair<intern_real, intern_real> get_elastic_energy_range() const;
 	std::pair<intern_real, intern_real> get_inelastic_energy_range() const;
@@ -77,8 +351,38 @@ public:
 private:
 	using intern_table1D_t = array1D_ax<intern_real, ax_list<intern_real>>;
 	using intern_table2D_t = array2D_ax<intern_real, ax_list<intern_real>, ax_linspace<intern_real>>;
-	using fast_table1D_t = array1D_ax<fast_real, ax_logspace<fast_real>>;
-	using fast_table2D_t = array2D_ax<fast_real, ax_logspace<fast_real>, ax_linspace<fast_real>>;
+	template<typename energy_axis_t>
+	using fast_table1D_t = array1D_ax<fast_real, energy_axis_t>;
+	template<typename energy_axis_t>
+	using fast_table2D_t = array2D_ax<fast_real, energy_axis_t, ax_unit_interval<fast_real>>;
+
+	// Identifies the energy axis of a fast table in the table cache and binary
+	// files: its range, and a hash of its parameters for axes other than
+	// ax_logspace. Zero hash for ax_logspace.
+	struct axis_key_t
+	{
+		fast_real K_min;
+		fast_real K_max;
+		uint64_t hash;
+	};
+
+	std::string source_filename; // Empty if loaded from a file image
+	uint64_t source_hash = 0; // For files: 0 until a table cache or shared store is set
+	std::shared_ptr<table_cache const> cache;
+	std::shared_ptr<shared_table_store const> shared_tables;
+	std::shared_ptr<binary_material_file const> binary_file; // If loaded from a binary file
+
+	// State for lazy loading, defined in material.cpp. nullptr if not loading lazily.
+	struct loader_t;
+	load_options options;
+	std::unique_ptr<loader_t> loader;
+	bool released = false; // See release_source_tables()
+
+	// Tables handed out by the get_shared_* functions, defined in material.cpp.
+	struct shared_tables_t;
+	std::unique_ptr<shared_tables_t> shared_fast_tables;
+	mutable io_statistics io_stats; // Protected by the HDF5 lock
+	unsigned int build_threads = 1;
 
 	std::string name;
 	conductor_type_t conductor_type;
@@ -89,23 +393,73 @@ private:
 	quantity<intern_real> effective_A;
 	quantity<intern_real> band_gap; // -1 eV if conductor_type == CND_METAL
 
-	intern_table1D_t elastic_cross_section;
-	intern_table2D_t elastic_angle_icdf;
+	// Mutable, as they may be loaded lazily.
+	mutable intern_table1D_t elastic_cross_section;
+	mutable intern_table2D_t elastic_angle_icdf;
+
+	mutable intern_table1D_t inelastic_cross_section;
+	mutable intern_table2D_t inelastic_w0_icdf;
+
+	mutable intern_table2D_t ionization_dE_icdf;
+	mutable std::vector<intern_real> outer_shells;
+
+	mutable intern_table1D_t electron_range;
+
+	// Initialise to invalid state, for load_binary.
+	basic_material();
 
-	intern_table1D_t inelastic_cross_section;
-	intern_table2D_t inelastic_w0_icdf;
+	// Copy other, with the tables of the given processes (bitwise OR of process_t),
+	// which are loaded first. Tables of other processes are left empty.
+	void copy_from(basic_material const & other, unsigned int processes);
 
-	intern_table2D_t ionization_dE_icdf;
-	std::vector<intern_real> outer_shells;
+	// Compute source_hash, if not known yet.
+	void compute_source_hash();
 
-	intern_table1D_t electron_range;
+	// Prebuilt fast table values in the binary file, or nullptr if not there.
+	fast_real* find_prebuilt(table_kind_t kind, fast_real K_min, fast_real K_max, size_t N_K, size_t N_P) const;
 
-	template<typename conversion_func>
-	static fast_table1D_t to_fast_table(intern_table1D_t const & intern,
-		fast_real K_min, fast_real K_max, size_t N, conversion_func f);
-	template<typename conversion_func>
-	static fast_table2D_t to_fast_table(intern_table2D_t const & intern,
-		fast_real K_min, fast_real K_max, size_t N_K, size_t N_P, conversion_func f);
+	// Read properties, and the tables or set up lazy loading, from an open file.
+	// Caller must hold the HDF5 lock.
+	// The image, if any, backs the file and is kept until the file is closed.
+	void read_hdf5(std::unique_ptr<H5::H5File> hdf5_file, std::unique_ptr<file_image> image);
+
+	// Make sure the tables for a process are available, loading them if necessary.
+	// Throws std::runtime_error if the process was not selected in the load_options.
+	void require(process_t process) const;
+	// Read the tables for a process from file. Caller must hold the HDF5 lock.
+	void read_process(H5::H5File const & file, process_t process) const;
+	static process_t get_process(table_kind_t kind);
+
+	// Find a table in shared_fast_tables, or build it with build() and store it there.
+	template<typename table_t, typename build_func>
+	std::shared_ptr<table_t const> get_shared(table_kind_t kind,
+		fast_real K_min, fast_real K_max, size_t N_K, size_t N_P, build_func build) const;
+
+	// Progressive table with a coarse table of N_K_coarse energies, see progressive_table.h.
+	// build(source, N, stored) builds a table with N energies from the tables of
+	// source; stored is false for the coarse table, which is not worth keeping in
+	// the table cache or shared memory. The final table is built from a copy of
+	// this material with the tables for the given process only, so that this
+	// one may be moved, released or destroyed while the build is in progress.
+	template<typename table_t, typename build_func>
+	progressive_table<table_t> make_progressive(process_t process,
+		size_t N_K, size_t N_K_coarse, build_func build) const;
+
+	// Build a fast table, or load it from the cache if one is set.
+	// f(intern, K, true_K) gives the value at energy K, with true_K its true index in
+	// the intern table; see array1D_ax::find_index. For 2D tables, f(intern, true_K, true_P)
+	// is given the true indices only. Indices are found in a sweep over the intern axes.
+	// If stored is false, the table cache and shared memory store are bypassed, for
+	// short-lived tables such as the coarse tables of the get_progressive_* functions.
+	template<typename energy_axis_t, typename conversion_func>
+	fast_table1D_t<energy_axis_t> to_fast_table(table_kind_t kind, intern_table1D_t const & intern,
+		energy_axis_t const & K_axis, axis_key_t const & axis_key, conversion_func f, bool stored = true) const;
+	template<typename energy_axis_t, typename conversion_func>
+	fast_table2D_t<energy_axis_t> to_fast_table(table_kind_t kind, intern_table2D_t const & intern,
+		energy_axis_t const & K_axis, axis_key_t const & axis_key, size_t N_P, conversion_func f, bool stored = true) const;
 };
 
+// Double precision intern tables, single precision fast tables.
+using material = basic_material<>;
+
 #endif
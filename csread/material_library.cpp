@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "material_library.h"
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material_library<intern_real_type, fast_real_type>::basic_material_library(std::vector<std::string> const & filenames, size_t N_threads) :
+	basic_material_library(filenames, load_options(), prepare_func(), N_threads)
+{}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material_library<intern_real_type, fast_real_type>::basic_material_library(std::vector<std::string> const & filenames, prepare_func prepare, size_t N_threads) :
+	basic_material_library(filenames, load_options(), std::move(prepare), N_threads)
+{}
+
+template<typename intern_real_type, typename fast_real_type>
+basic_material_library<intern_real_type, fast_real_type>::basic_material_library(std::vector<std::string> const & filenames, load_options const & options,
+	prepare_func prepare, size_t N_threads) :
+	entries(filenames.size())
+{
+	for (size_t i = 0; i < filenames.size(); ++i)
+		entries[i].filename = filenames[i];
+
+	if (N_threads == 0)
+		N_threads = std::thread::hardware_concurrency();
+	N_threads = std::max<size_t>(1, std::min(N_threads, filenames.size()));
+
+	// Each worker takes the next unclaimed file until all are done.
+	std::atomic<size_t> next_index(0);
+	auto worker = [this, &next_index, &options, &prepare]()
+	{
+		for (size_t i = next_index++; i < entries.size(); i = next_index++)
+		{
+			entry_t& entry = entries[i];
+			try
+			{
+				std::unique_ptr<material_t> mat(new material_t(entry.filename, options));
+				if (prepare)
+					prepare(*mat, i);
+				entry.mat = std::move(mat);
+			}
+			catch (std::exception const & error)
+			{
+				entry.error = error.what();
+			}
+			catch (...)
+			{
+				entry.error = "Unknown error.";
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < N_threads; ++t)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+size_t basic_material_library<intern_real_type, fast_real_type>::size() const
+{
+	return entries.size();
+}
+
+template<typename intern_real_type, typename fast_real_type>
+bool basic_material_library<intern_real_type, fast_real_type>::ok() const
+{
+	return std::all_of(entries.begin(), entries.end(),
+		[](entry_t const & entry) { return entry.mat != nullptr; });
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material_library<intern_real_type, fast_real_type>::operator[](size_t i) const -> material_t const &
+{
+	return at(i);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material_library<intern_real_type, fast_real_type>::at(size_t i) const -> material_t const &
+{
+	entry_t const & entry = entries.at(i);
+	if (entry.mat == nullptr)
+		throw std::runtime_error("Material " + entry.filename + " failed to load: " + entry.error);
+	return *entry.mat;
+}
+
+template<typename intern_real_type, typename fast_real_type>
+auto basic_material_library<intern_real_type, fast_real_type>::get_entry(size_t i) const -> entry_t const &
+{
+	return entries.at(i);
+}
+
+template<typename intern_real_type, typename fast_real_type>
+std::vector<std::string> basic_material_library<intern_real_type, fast_real_type>::get_errors() const
+{
+	std::vector<std::string> errors;
+	for (entry_t const & entry : entries)
+	{
+		if (entry.mat == nullptr)
+			errors.push_back(entry.filename + ": " + entry.error);
+	}
+	return errors;
+}
+
+// Precisions available, see material.h.
+template class basic_material_library<double, float>;
+template class basic_material_library<double, double>;
+template class basic_material_library<float, float>;
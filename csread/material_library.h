@@ -0,0 +1,75 @@
+#ifndef __MATERIAL_LIBRARY_H_
+#define __MATERIAL_LIBRARY_H_
+
+/*
+ * Loads a list of materials concurrently.
+ *
+ * Each file is loaded on a pool of worker threads. Reading the HDF5 files is
+ * serialized internally (see material.cpp), so the threads only speed up the
+ * remaining work, in particular building the fast tables in an optional
+ * "prepare" callback. Loading with load_options::lazy moves most of the HDF5
+ * reading out of the constructor and into that callback, where it is still
+ * serialized.
+ *
+ * Materials are returned in the order in which the file names were given.
+ * Failure to load one file does not stop the others: the error message is
+ * recorded for that file instead.
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "material.h"
+
+template<typename intern_real_type = double, typename fast_real_type = float>
+class basic_material_library
+{
+public:
+	using material_t = basic_material<intern_real_type, fast_real_type>;
+	using load_options = material_base::load_options;
+
+	struct entry_t
+	{
+		std::string filename;
+		std::unique_ptr<material_t> mat; // nullptr if loading failed
+		std::string error;               // Empty if loading succeeded
+	};
+
+	// Called on the worker thread after a material has been loaded, typically
+	// to set it up (set_table_cache, set_build_threads, ...) and build the fast
+	// tables. The second parameter is the material's index.
+	// Exceptions thrown are recorded as an error for that material.
+	using prepare_func = std::function<void(material_t &, size_t)>;
+
+	// Load materials using up to N_threads worker threads.
+	// If N_threads == 0, std::thread::hardware_concurrency() is used.
+	basic_material_library(std::vector<std::string> const & filenames, size_t N_threads = 0);
+	basic_material_library(std::vector<std::string> const & filenames, prepare_func prepare, size_t N_threads = 0);
+	basic_material_library(std::vector<std::string> const & filenames, load_options const & options,
+		prepare_func prepare = prepare_func(), size_t N_threads = 0);
+
+	basic_material_library(basic_material_library &&) = default;
+	basic_material_library& operator=(basic_material_library &&) = default;
+
+	// Number of materials, including those that failed to load.
+	size_t size() const;
+	// True if all materials were loaded successfully.
+	bool ok() const;
+
+	// Access a material. Throws std::runtime_error if that material failed to load.
+	material_t const & operator[](size_t i) const;
+	material_t const & at(size_t i) const;
+
+	entry_t const & get_entry(size_t i) const;
+	// Error messages, formatted as "filename: message", for the materials that failed.
+	std::vector<std::string> get_errors() const;
+
+private:
+	std::vector<entry_t> entries;
+};
+
+// Double precision intern tables, single precision fast tables.
+using material_library = basic_material_library<>;
+
+#endif
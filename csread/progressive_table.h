@@ -0,0 +1,128 @@
+#ifndef __PROGRESSIVE_TABLE_H_
+#define __PROGRESSIVE_TABLE_H_
+
+/*
+ * Handle to a fast table that starts at coarse resolution and is upgraded in
+ * place once the final table, built on a background thread, is ready. Lets a
+ * simulation start right away instead of waiting for the final table.
+ *
+ * Readers call current() whenever they like, typically once per batch of
+ * electrons. The switch to the final table is a single atomic pointer store
+ * with release ordering, and current() loads it with acquire ordering, so a
+ * reader that sees the final table sees it completely built. Both tables stay
+ * valid for the lifetime of the handle, so a reader may keep using the coarse
+ * table it obtained earlier.
+ *
+ * The destructor waits for the background thread, so whatever the build
+ * function refers to must outlive the handle. The get_progressive_* functions
+ * of a material hand it a copy of the tables it needs, so the material need not.
+ * A moved-from handle holds no tables; current(), is_final() and wait()
+ * throw std::runtime_error on it.
+ */
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+template<typename table_t>
+class progressive_table
+{
+public:
+	using table_type = table_t;
+
+	// Start with the coarse table, and build the final one with build() on a
+	// background thread.
+	template<typename build_func>
+	progressive_table(table_t coarse, build_func build) :
+		_state(new state_t(std::unique_ptr<table_t>(new table_t(std::move(coarse)))))
+	{
+		state_t* state = _state.get();
+		_done = std::async(std::launch::async, [state, build]()
+		{
+			state->final_table.reset(new table_t(build()));
+			state->current.store(state->final_table.get(), std::memory_order_release);
+		}).share();
+	}
+
+	// A table that is final from the start.
+	explicit progressive_table(table_t final_table) :
+		_state(new state_t(nullptr))
+	{
+		_state->final_table.reset(new table_t(std::move(final_table)));
+		_state->current.store(_state->final_table.get(), std::memory_order_release);
+		std::promise<void> done;
+		done.set_value();
+		_done = done.get_future().share();
+	}
+
+	~progressive_table()
+	{
+		if (_done.valid())
+			_done.wait();
+	}
+
+	progressive_table(progressive_table &&) = default;
+	progressive_table& operator=(progressive_table && rhs)
+	{
+		if (this != &rhs)
+		{
+			// Our background thread must be done before our state goes.
+			if (_done.valid())
+				_done.wait();
+			_state = std::move(rhs._state);
+			_done = std::move(rhs._done);
+		}
+		return *this;
+	}
+
+	// The table to use now: coarse or final. Thread-safe, lock-free.
+	table_t const & current() const
+	{
+		return *state().current.load(std::memory_order_acquire);
+	}
+
+	// True once current() returns the final table.
+	bool is_final() const
+	{
+		state_t const & s = state();
+		return s.current.load(std::memory_order_acquire) != s.coarse_table.get();
+	}
+
+	// Wait until the final table is ready, and return it. If building it
+	// failed, the exception is rethrown here and the coarse table stays in use.
+	table_t const & wait() const
+	{
+		state(); // Throws if moved from
+		_done.get();
+		return current();
+	}
+
+private:
+	struct state_t
+	{
+		state_t(std::unique_ptr<table_t> coarse) :
+			coarse_table(std::move(coarse)), current(coarse_table.get())
+		{}
+
+		std::unique_ptr<table_t> const coarse_table;
+		std::unique_ptr<table_t> final_table; // Written by the background thread only
+		std::atomic<table_t const *> current;
+	};
+
+	std::unique_ptr<state_t> _state;
+	std::shared_future<void> _done;
+
+	state_t const & state() const
+	{
+		if (_state == nullptr)
+			throw std::runtime_error("progressive_table has been moved from.");
+		return *_state;
+	}
+
+	progressive_table(progressive_table const &) = delete;
+	progressive_table& operator=(progressive_table const &) = delete;
+};
+
+#endif
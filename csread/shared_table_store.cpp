@@ -0,0 +1,260 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "shared_table_store.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CSREAD_HAVE_SHM
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Segment layout:
+ *   segment_header
+ *   values, starting at data_offset
+ */
+
+namespace
+{
+	enum segment_state_t : uint32_t
+	{
+		SEG_BUILDING = 0, // Zero, because a new segment is zero-filled
+		SEG_READY,
+		SEG_FAILED
+	};
+
+	struct segment_header
+	{
+		char magic[8];
+		table_cache::key_t key;
+		uint64_t data_size;
+		std::atomic<uint32_t> state; // segment_state_t
+	};
+
+	// The last character is a version, changed with the table cache version
+	// whenever the table values change.
+	const char segment_magic[8] = "csrdsh3";
+	const size_t data_offset = (sizeof(segment_header) + 63) / 64 * 64;
+
+	static_assert(ATOMIC_INT_LOCK_FREE == 2, "Shared memory synchronisation requires lock-free atomics.");
+}
+
+shared_table_store::shared_table_store(std::string const & prefix, double timeout_seconds) :
+	prefix(prefix), timeout_seconds(timeout_seconds)
+{}
+
+std::string const & shared_table_store::get_prefix() const
+{
+	return prefix;
+}
+
+#ifdef CSREAD_HAVE_SHM
+
+// True if no process holds the lock on the segment: its builder is done or
+// died. False if it is still building, or if locks are not supported.
+bool builder_gone(int fd)
+{
+	if (flock(fd, LOCK_SH | LOCK_NB) != 0)
+		return false;
+	flock(fd, LOCK_UN);
+	return true;
+}
+
+void const * shared_table_store::get(key_t const & key, size_t count,
+	std::function<void(void*)> const & fill,
+	std::shared_ptr<void const>& segment) const
+{
+	char hash[24];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(table_cache::hash_key(key)));
+	const std::string name = "/" + prefix + hash;
+
+	const size_t data_size = count * key.value_size;
+	const size_t total_size = data_offset + data_size;
+	auto make_segment = [total_size](void* address) -> std::shared_ptr<void const>
+	{
+		return std::shared_ptr<void const>(address,
+			[total_size](void const * p) { munmap(const_cast<void*>(p), total_size); });
+	};
+
+	// A segment left behind by a builder that died, or that took too long, is
+	// removed and we try once more to create it.
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		// Try to create the segment. If that succeeds, we are the one building
+		// the table. We hold a lock on it until done, see builder_gone().
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd >= 0)
+		{
+			flock(fd, LOCK_EX);
+			// Reserve the memory now: writing to pages that do not fit in a
+			// full /dev/shm raises SIGBUS.
+			if (ftruncate(fd, total_size) != 0
+#ifdef __linux__
+				|| posix_fallocate(fd, 0, total_size) != 0
+#endif
+				)
+			{
+				shm_unlink(name.c_str());
+				close(fd);
+				return nullptr;
+			}
+			void* address = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (address == MAP_FAILED)
+			{
+				shm_unlink(name.c_str());
+				close(fd);
+				return nullptr;
+			}
+
+			segment_header* header = static_cast<segment_header*>(address);
+			std::memcpy(header->magic, segment_magic, sizeof(segment_magic));
+			header->key = key;
+			header->data_size = data_size;
+			char* data = static_cast<char*>(address) + data_offset;
+
+			try
+			{
+				fill(data);
+			}
+			catch (...)
+			{
+				// Let waiting processes know, and let the next one try again.
+				header->state.store(SEG_FAILED, std::memory_order_release);
+				shm_unlink(name.c_str());
+				close(fd);
+				munmap(address, total_size);
+				throw;
+			}
+
+			header->state.store(SEG_READY, std::memory_order_release);
+			close(fd);
+			mprotect(address, total_size, PROT_READ);
+			segment = make_segment(address);
+			return data;
+		}
+		if (errno != EEXIST)
+			return nullptr;
+
+		// Another process created the segment. Attach, and wait for it to be ready.
+		fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+		{
+			if (errno == ENOENT)
+				continue; // Removed in the meantime
+			return nullptr;
+		}
+
+		const auto deadline = std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout_seconds));
+		auto wait = [&deadline]() -> bool
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			return true;
+		};
+
+		// The creator may not have set the size yet
+		struct stat segment_stat {};
+		while (fstat(fd, &segment_stat) == 0 && segment_stat.st_size == 0 && wait())
+		{}
+		if (segment_stat.st_uid != geteuid())
+		{
+			// Not ours, so not to be trusted. We cannot remove it either.
+			close(fd);
+			return nullptr;
+		}
+		if (segment_stat.st_size == 0)
+		{
+			// The creator died before setting the size, or is stuck
+			close(fd);
+			shm_unlink(name.c_str());
+			continue;
+		}
+		if (static_cast<size_t>(segment_stat.st_size) != total_size)
+		{
+			// Left behind by another version of this library? Otherwise, this
+			// is another table whose key has the same hash.
+			bool foreign = false;
+			if (static_cast<size_t>(segment_stat.st_size) >= sizeof(segment_header))
+			{
+				void* address = mmap(nullptr, sizeof(segment_header), PROT_READ, MAP_SHARED, fd, 0);
+				if (address != MAP_FAILED)
+				{
+					foreign = std::memcmp(static_cast<segment_header const *>(address)->magic,
+						segment_magic, sizeof(segment_magic)) != 0;
+					munmap(address, sizeof(segment_header));
+				}
+			}
+			foreign = foreign && builder_gone(fd);
+			close(fd);
+			if (foreign)
+			{
+				shm_unlink(name.c_str());
+				continue;
+			}
+			return nullptr;
+		}
+
+		void* address = mmap(nullptr, total_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED)
+		{
+			close(fd);
+			return nullptr;
+		}
+
+		segment_header const * header = static_cast<segment_header const *>(address);
+		uint32_t state;
+		bool stale = false;
+		while ((state = header->state.load(std::memory_order_acquire)) == SEG_BUILDING)
+		{
+			// Check the state again after the lock: the builder may just have finished.
+			if ((builder_gone(fd) && header->state.load(std::memory_order_acquire) == SEG_BUILDING) || !wait())
+			{
+				stale = true;
+				break;
+			}
+		}
+		// Left behind by another version of this library. The magic is written
+		// before the state, so a segment that is not building has ours.
+		if (!stale && std::memcmp(header->magic, segment_magic, sizeof(segment_magic)) != 0 && builder_gone(fd))
+			stale = true;
+		close(fd);
+		if (stale)
+		{
+			munmap(address, total_size);
+			shm_unlink(name.c_str());
+			continue;
+		}
+		if (state != SEG_READY
+			|| std::memcmp(header->magic, segment_magic, sizeof(segment_magic)) != 0
+			|| !table_cache::keys_equal(header->key, key)
+			|| header->data_size != data_size)
+		{
+			munmap(address, total_size);
+			return nullptr;
+		}
+
+		segment = make_segment(address);
+		return static_cast<char const *>(address) + data_offset;
+	}
+	return nullptr;
+}
+
+#else // CSREAD_HAVE_SHM
+
+void const * shared_table_store::get(key_t const &, size_t,
+	std::function<void(void*)> const &,
+	std::shared_ptr<void const>&) const
+{
+	return nullptr;
+}
+
+#endif // CSREAD_HAVE_SHM
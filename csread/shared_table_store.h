@@ -0,0 +1,62 @@
+#ifndef __SHARED_TABLE_STORE_H_
+#define __SHARED_TABLE_STORE_H_
+
+/*
+ * Shares fast tables between processes on the same machine, through named
+ * POSIX shared memory segments.
+ *
+ * The first process to ask for a table creates a segment, builds the table in
+ * it and marks it ready. Other processes asking for the same table attach to
+ * that segment read-only, waiting for it to become ready if necessary. Tables
+ * that refer to a segment must therefore not be written to.
+ *
+ * Segment names start with the given prefix, followed by a hash of the table
+ * key (see table_cache.h). Segments are not removed when processes exit, so
+ * that later runs can use them too. On Linux, they can be found in /dev/shm.
+ *
+ * Segments can only be read by the user that created them, and segments
+ * created by other users are not used: they could contain anything. Segments
+ * with the layout of another version of this library are removed.
+ *
+ * The memory for a segment is reserved when it is created, so that a full
+ * /dev/shm makes get() fail rather than the process crash.
+ *
+ * The builder holds a lock (flock) on the segment until the table is ready.
+ * If it dies while building, the lock is released; waiting processes then
+ * remove the segment and one of them builds the table again. The same
+ * happens if building takes longer than the timeout.
+ *
+ * If anything goes wrong with the shared memory, get() returns nullptr and the
+ * caller should build the table on its own.
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "table_cache.h"
+
+class shared_table_store
+{
+public:
+	using key_t = table_cache::key_t;
+
+	// Maximum time to wait for another process to finish building a table.
+	// If it takes longer, that process is probably stuck and we build it again.
+	shared_table_store(std::string const & prefix, double timeout_seconds = 60);
+
+	// Get the data for a table with "count" values.
+	// If no other process published it yet, fill() is called to fill the data.
+	// The returned pointer is kept alive by "segment".
+	// Returns nullptr if the table could not be shared.
+	void const * get(key_t const & key, size_t count,
+		std::function<void(void*)> const & fill,
+		std::shared_ptr<void const>& segment) const;
+
+	std::string const & get_prefix() const;
+
+private:
+	std::string prefix;
+	double timeout_seconds;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "batch.h"
+#include "../table/table_index.h"
+
+/*
+ * Instruction set selection. The kernels are in batch_avx2.cpp and
+ * batch_avx512.cpp; CMakeLists.txt defines CSREAD_BATCH_AVX2 and
+ * CSREAD_BATCH_AVX512 for this file if they are built.
+ */
+
+bool simd_isa_supported(simd_isa_t isa)
+{
+	switch (isa)
+	{
+	case SIMD_SCALAR:
+		return true;
+#ifdef CSREAD_BATCH_AVX2
+	case SIMD_AVX2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#ifdef CSREAD_BATCH_AVX512
+	case SIMD_AVX512:
+		return __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return false;
+	}
+}
+
+std::atomic<int>& simd_isa_state()
+{
+	static std::atomic<int> isa(-1);
+	return isa;
+}
+
+simd_isa_t simd_batch_isa()
+{
+	int isa = simd_isa_state().load(std::memory_order_relaxed);
+	if (isa < 0)
+	{
+		isa = SIMD_SCALAR;
+		for (simd_isa_t candidate : { SIMD_AVX512, SIMD_AVX2 })
+		{
+			if (simd_isa_supported(candidate))
+			{
+				isa = candidate;
+				break;
+			}
+		}
+		simd_isa_state().store(isa, std::memory_order_relaxed);
+	}
+	return static_cast<simd_isa_t>(isa);
+}
+
+void simd_batch_force_isa(simd_isa_t isa)
+{
+	if (!simd_isa_supported(isa))
+		throw std::runtime_error("Instruction set not supported by this CPU or build.");
+	simd_isa_state().store(isa, std::memory_order_relaxed);
+}
+
+/*
+ * Kernels
+ */
+
+void simd_batch_exp_linear(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n)
+{
+	// The kernels use 32-bit indices
+	if (N >= (size_t(1) << 31))
+		return simd_batch_exp_linear_scalar(log_values, N, log_low, log_inv_step, K, out, n);
+
+	switch (simd_batch_isa())
+	{
+#ifdef CSREAD_BATCH_AVX512
+	case SIMD_AVX512:
+		return simd_batch_exp_linear_avx512(log_values, N, log_low, log_inv_step, K, out, n);
+#endif
+#ifdef CSREAD_BATCH_AVX2
+	case SIMD_AVX2:
+		return simd_batch_exp_linear_avx2(log_values, N, log_low, log_inv_step, K, out, n);
+#endif
+	default:
+		return simd_batch_exp_linear_scalar(log_values, N, log_low, log_inv_step, K, out, n);
+	}
+}
+
+void simd_batch_bilinear(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	// The kernels use 32-bit indices
+	if (N_K*N_P >= (size_t(1) << 31))
+		return simd_batch_bilinear_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+
+	switch (simd_batch_isa())
+	{
+#ifdef CSREAD_BATCH_AVX512
+	case SIMD_AVX512:
+		return simd_batch_bilinear_avx512(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+#endif
+#ifdef CSREAD_BATCH_AVX2
+	case SIMD_AVX2:
+		return simd_batch_bilinear_avx2(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+#endif
+	default:
+		return simd_batch_bilinear_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+	}
+}
+
+void simd_batch_rounddown(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	// The kernels use 32-bit indices
+	if (N_K*N_P >= (size_t(1) << 31))
+		return simd_batch_rounddown_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+
+	switch (simd_batch_isa())
+	{
+#ifdef CSREAD_BATCH_AVX512
+	case SIMD_AVX512:
+		return simd_batch_rounddown_avx512(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+#endif
+#ifdef CSREAD_BATCH_AVX2
+	case SIMD_AVX2:
+		return simd_batch_rounddown_avx2(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+#endif
+	default:
+		return simd_batch_rounddown_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+	}
+}
+
+void simd_batch_exp_linear_scalar(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n)
+{
+	// Same as ax_logspace::find and array1D_ax::at_linear_index
+	for (size_t i = 0; i < n; ++i)
+	{
+		const linear_index<float> index((std::log(K[i]) - log_low) * log_inv_step, N);
+		const float low_value = log_values[index.low];
+		const float high_value = log_values[index.low + 1];
+		out[i] = std::exp((1 - index.frac)*low_value + index.frac*high_value);
+	}
+}
+
+void simd_batch_bilinear_scalar(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	// Same as ax_logspace::find, ax_linspace::find and array2D_ax::at_linear_index
+	for (size_t i = 0; i < n; ++i)
+	{
+		const linear_index<float> index_x((std::log(K[i]) - log_low) * log_inv_step, N_K);
+		const linear_index<float> index_y((P[i] - P_low) * P_inv_step, N_P);
+		const float frac_x = index_x.frac;
+		const float frac_y = index_y.frac;
+
+		const float* v0 = values + index_x.low*N_P + index_y.low;
+		const float* v1 = v0 + N_P;
+		out[i] = (1 - frac_x)*(1 - frac_y)*v0[0]
+			+ frac_x*(1 - frac_y)*v1[0]
+			+ (1 - frac_x)*frac_y*v0[1]
+			+ frac_x*frac_y*v1[1];
+	}
+}
+
+void simd_batch_rounddown_scalar(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	// Same as ionization_table::get
+	for (size_t i = 0; i < n; ++i)
+	{
+		const float true_x = (std::log(K[i]) - log_low) * log_inv_step;
+		const float true_y = (P[i] - P_low) * P_inv_step;
+
+		if (true_x < 0 || true_y < 0)
+		{
+			out[i] = -1;
+			continue;
+		}
+
+		out[i] = values[rounddown_index(true_x, N_K)*N_P + rounddown_index(true_y, N_P)];
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef __SIMD_BATCH_H_
+#define __SIMD_BATCH_H_
+
+/*
+ * Vectorized lookups in single precision fast tables, for many electrons at
+ * once. The kernels for each instruction set live in their own translation
+ * unit, compiled with the flags for that instruction set; the best one the
+ * CPU supports is selected at run time. Other CPUs, and builds without the
+ * kernels, use scalar code.
+ *
+ * The kernels repeat the arithmetic of the scalar lookups, except for log()
+ * and exp(), which are polynomial approximations accurate to 1 ULP and 2 ULP.
+ * A 1 ULP difference in log(K) shifts the interpolation weight f, which
+ * changes the interpolated log value by its slope and by the round-off in the
+ * two weighted terms (1-f)*v_low and f*v_high. For imfp_table, the relative
+ * difference from get() is therefore at most
+ *     (2 + |log K * d log(imfp) / d log K| + 2 * max(|(1-f)*v_low|, |f*v_high|)) * 2^-23.
+ * In the table's energy range, the last term is about |log(imfp)|, in the
+ * units of the table; in practice the difference is a few to a few tens of
+ * ULP. For the bilinear interpolation of icdf_table, the same reasoning gives
+ * an absolute difference of at most
+ *     (|log K * d value / d log K| + 4 * max |weight * value| + 3 * |value|) * 2^-23,
+ * with the maximum over the four corners; the last term is the round-off in
+ * the three additions. The round-down lookup of ionization_table matches
+ * exactly, unless a 1 ULP difference in log(K) moves K across a grid energy;
+ * it then returns the binding energy of the neighbouring cell. Inputs that
+ * are not normal, positive and finite, and results close to the float range,
+ * are handled by the scalar code and match exactly.
+ *
+ * The scalar code uses std::log and std::exp, so the tables only use these
+ * functions on axes with exact_math (table/math_policy.h). With fast_math,
+ * get_batch() calls get() for each sample.
+ *
+ * All tables must have fewer than 2^31 elements.
+ */
+
+#include <cstddef>
+
+// Instruction sets with batch kernels
+enum simd_isa_t
+{
+	SIMD_SCALAR,
+	SIMD_AVX2,   // AVX2 and FMA
+	SIMD_AVX512  // AVX-512F
+};
+
+// The instruction set used by the functions below. Decided at the first call.
+simd_isa_t simd_batch_isa();
+// Force an instruction set, for testing. Must be supported by the CPU and by
+// this build; throws std::runtime_error otherwise.
+void simd_batch_force_isa(simd_isa_t isa);
+
+// out[i] = exp(linear interpolation in log_values at (log(K[i]) - log_low) * log_inv_step),
+// clamped like array1D_ax::at_linear. See imfp_table::get_batch.
+void simd_batch_exp_linear(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n);
+
+// out[i] = bilinear interpolation in values, N_K rows of N_P, at row
+// (log(K[i]) - log_low) * log_inv_step and column (P[i] - P_low) * P_inv_step,
+// clamped like array2D_ax::at_linear. See icdf_table::get_batch.
+void simd_batch_bilinear(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+
+// out[i] = the value in the same row and column as above, both rounded down.
+// -1 below the table, the last row or column above it. See ionization_table::get_batch.
+void simd_batch_rounddown(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+
+// Kernels per instruction set, same parameters as the above.
+void simd_batch_exp_linear_scalar(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n);
+void simd_batch_exp_linear_avx2(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n);
+void simd_batch_exp_linear_avx512(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n);
+
+void simd_batch_bilinear_scalar(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+void simd_batch_bilinear_avx2(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+void simd_batch_bilinear_avx512(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+
+void simd_batch_rounddown_scalar(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+void simd_batch_rounddown_avx2(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+void simd_batch_rounddown_avx512(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n);
+
+#endif
@@ -0,0 +1,23 @@
+// Compiled with -mavx512f -ffp-contract=off, see CMakeLists.txt.
+// Only called when the CPU supports these.
+
+#include "simd_avx512.h"
+#include "batch_kernels.h"
+
+void simd_batch_exp_linear_avx512(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n)
+{
+	batch_exp_linear<simd_avx512>(log_values, N, log_low, log_inv_step, K, out, n);
+}
+void simd_batch_bilinear_avx512(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	batch_bilinear<simd_avx512>(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+}
+void simd_batch_rounddown_avx512(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	batch_rounddown<simd_avx512>(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step, K, P, out, n);
+}
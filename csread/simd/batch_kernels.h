@@ -0,0 +1,231 @@
+#ifndef __SIMD_BATCH_KERNELS_H_
+#define __SIMD_BATCH_KERNELS_H_
+
+/*
+ * Batch kernels, written once for all instruction sets. The template
+ * parameter is one of the simd_* structs (simd_avx2.h, simd_avx512.h),
+ * which provide:
+ *   real, index, mask, width, leave
+ *   load, store, set1
+ *   add, sub, mul, fmadd, min, max, floor (real)
+ *   less, select, all_within
+ *   to_index, to_real, set1_index, add, mul (index), gather
+ *   split, scale2
+ *
+ * The kernels repeat the arithmetic of the scalar lookups in the same order,
+ * so they must be compiled with -ffp-contract=off. Elements that are not
+ * handled exactly like the scalar code would are passed to the scalar kernels.
+ */
+
+#include <cfloat>
+#include <cstddef>
+#include "batch.h"
+
+// Natural log of positive normal x, to 1 ULP. After Cephes logf.
+template<typename simd>
+typename simd::real simd_log(typename simd::real x)
+{
+	using real = typename simd::real;
+	const real one = simd::set1(1.f);
+
+	real m, e;
+	simd::split(x, m, e);
+	// Move m to [sqrt(1/2), sqrt(2)) and subtract 1
+	const typename simd::mask small = simd::less(m, simd::set1(0.707106781186547524f));
+	e = simd::select(small, simd::sub(e, one), e);
+	m = simd::sub(simd::select(small, simd::add(m, m), m), one);
+
+	const real z = simd::mul(m, m);
+	real y = simd::set1(7.0376836292e-2f);
+	y = simd::fmadd(y, m, simd::set1(-1.1514610310e-1f));
+	y = simd::fmadd(y, m, simd::set1(1.1676998740e-1f));
+	y = simd::fmadd(y, m, simd::set1(-1.2420140846e-1f));
+	y = simd::fmadd(y, m, simd::set1(1.4249322787e-1f));
+	y = simd::fmadd(y, m, simd::set1(-1.6668057665e-1f));
+	y = simd::fmadd(y, m, simd::set1(2.0000714765e-1f));
+	y = simd::fmadd(y, m, simd::set1(-2.4999993993e-1f));
+	y = simd::fmadd(y, m, simd::set1(3.3333331174e-1f));
+	y = simd::mul(simd::mul(y, m), z);
+
+	// log(2) = 0.693359375 - 2.12194440e-4, the first part is exact
+	y = simd::fmadd(e, simd::set1(-2.12194440e-4f), y);
+	y = simd::fmadd(z, simd::set1(-0.5f), y);
+	return simd::fmadd(e, simd::set1(0.693359375f), simd::add(m, y));
+}
+
+// Valid input range of simd_exp: the result is a normal float.
+const float simd_exp_min = -87.f;
+const float simd_exp_max = 88.f;
+
+// exp(x) for x in [simd_exp_min, simd_exp_max], to 2 ULP. After Cephes expf.
+template<typename simd>
+typename simd::real simd_exp(typename simd::real x)
+{
+	using real = typename simd::real;
+
+	// x = n*log(2) + r, |r| <= log(2)/2
+	const real n = simd::floor(simd::fmadd(x, simd::set1(1.44269504088896341f), simd::set1(.5f)));
+	x = simd::fmadd(n, simd::set1(-0.693359375f), x);
+	x = simd::fmadd(n, simd::set1(2.12194440e-4f), x);
+
+	const real z = simd::mul(x, x);
+	real y = simd::set1(1.9875691500e-4f);
+	y = simd::fmadd(y, x, simd::set1(1.3981999507e-3f));
+	y = simd::fmadd(y, x, simd::set1(8.3334519073e-3f));
+	y = simd::fmadd(y, x, simd::set1(4.1665795894e-2f));
+	y = simd::fmadd(y, x, simd::set1(1.6666665459e-1f));
+	y = simd::fmadd(y, x, simd::set1(5.0000001201e-1f));
+	y = simd::add(simd::fmadd(y, z, x), simd::set1(1.f));
+	return simd::scale2(y, n);
+}
+
+// See simd_batch_exp_linear in batch.h.
+template<typename simd>
+void batch_exp_linear(float const * log_values, size_t N, float log_low, float log_inv_step,
+	float const * K, float* out, size_t n)
+{
+	using real = typename simd::real;
+	using index = typename simd::index;
+	const real llow = simd::set1(log_low);
+	const real linv = simd::set1(log_inv_step);
+	const real zero = simd::set1(0.f);
+	const real one = simd::set1(1.f);
+	const real max_index = simd::set1(static_cast<float>(N - 2));
+	const index one_index = simd::set1_index(1);
+
+	size_t i = 0;
+	for (; i + simd::width <= n; i += simd::width)
+	{
+		const real x = simd::load(K + i);
+		if (simd::all_within(x, FLT_MIN, FLT_MAX))
+		{
+			// As ax_logspace::find and array1D_ax::at_linear_index
+			const real true_index = simd::mul(simd::sub(simd_log<simd>(x), llow), linv);
+			const index low_index = simd::to_index(simd::max(zero, simd::min(true_index, max_index)));
+			const real frac_index = simd::sub(true_index, simd::to_real(low_index));
+			const real low_value = simd::gather(log_values, low_index);
+			const real high_value = simd::gather(log_values, simd::add(low_index, one_index));
+			const real value = simd::add(
+				simd::mul(simd::sub(one, frac_index), low_value),
+				simd::mul(frac_index, high_value));
+
+			if (simd::all_within(value, simd_exp_min, simd_exp_max))
+			{
+				simd::store(out + i, simd_exp<simd>(value));
+				continue;
+			}
+		}
+		simd::leave();
+		simd_batch_exp_linear_scalar(log_values, N, log_low, log_inv_step, K + i, out + i, simd::width);
+	}
+	simd::leave();
+	simd_batch_exp_linear_scalar(log_values, N, log_low, log_inv_step, K + i, out + i, n - i);
+}
+
+// See simd_batch_bilinear in batch.h.
+template<typename simd>
+void batch_bilinear(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	using real = typename simd::real;
+	using index = typename simd::index;
+	const real llow = simd::set1(log_low);
+	const real linv = simd::set1(log_inv_step);
+	const real plow = simd::set1(P_low);
+	const real pinv = simd::set1(P_inv_step);
+	const real zero = simd::set1(0.f);
+	const real one = simd::set1(1.f);
+	const real max_x = simd::set1(static_cast<float>(N_K - 2));
+	const real max_y = simd::set1(static_cast<float>(N_P - 2));
+	const index row = simd::set1_index(static_cast<int32_t>(N_P));
+	const index one_index = simd::set1_index(1);
+
+	size_t i = 0;
+	for (; i + simd::width <= n; i += simd::width)
+	{
+		const real x = simd::load(K + i);
+		const real y = simd::load(P + i);
+		if (simd::all_within(x, FLT_MIN, FLT_MAX) && simd::all_within(y, -FLT_MAX, FLT_MAX))
+		{
+			// As ax_logspace::find, ax_linspace::find and array2D_ax::at_linear_index
+			const real true_x = simd::mul(simd::sub(simd_log<simd>(x), llow), linv);
+			const real true_y = simd::mul(simd::sub(y, plow), pinv);
+			const index low_x = simd::to_index(simd::max(zero, simd::min(true_x, max_x)));
+			const index low_y = simd::to_index(simd::max(zero, simd::min(true_y, max_y)));
+			const real frac_x = simd::sub(true_x, simd::to_real(low_x));
+			const real frac_y = simd::sub(true_y, simd::to_real(low_y));
+
+			const index i00 = simd::add(simd::mul(low_x, row), low_y);
+			const index i10 = simd::add(i00, row);
+			const real v00 = simd::gather(values, i00);
+			const real v10 = simd::gather(values, i10);
+			const real v01 = simd::gather(values, simd::add(i00, one_index));
+			const real v11 = simd::gather(values, simd::add(i10, one_index));
+
+			const real rest_x = simd::sub(one, frac_x);
+			const real rest_y = simd::sub(one, frac_y);
+			real value = simd::mul(simd::mul(rest_x, rest_y), v00);
+			value = simd::add(value, simd::mul(simd::mul(frac_x, rest_y), v10));
+			value = simd::add(value, simd::mul(simd::mul(rest_x, frac_y), v01));
+			value = simd::add(value, simd::mul(simd::mul(frac_x, frac_y), v11));
+			simd::store(out + i, value);
+			continue;
+		}
+		simd::leave();
+		simd_batch_bilinear_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step,
+			K + i, P + i, out + i, simd::width);
+	}
+	simd::leave();
+	simd_batch_bilinear_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step,
+		K + i, P + i, out + i, n - i);
+}
+
+// See simd_batch_rounddown in batch.h.
+template<typename simd>
+void batch_rounddown(float const * values, size_t N_K, size_t N_P,
+	float log_low, float log_inv_step, float P_low, float P_inv_step,
+	float const * K, float const * P, float* out, size_t n)
+{
+	using real = typename simd::real;
+	using index = typename simd::index;
+	const real llow = simd::set1(log_low);
+	const real linv = simd::set1(log_inv_step);
+	const real plow = simd::set1(P_low);
+	const real pinv = simd::set1(P_inv_step);
+	const real zero = simd::set1(0.f);
+	const real none = simd::set1(-1.f);
+	const real max_x = simd::set1(static_cast<float>(N_K - 1));
+	const real max_y = simd::set1(static_cast<float>(N_P - 1));
+	const index row = simd::set1_index(static_cast<int32_t>(N_P));
+
+	size_t i = 0;
+	for (; i + simd::width <= n; i += simd::width)
+	{
+		const real x = simd::load(K + i);
+		const real y = simd::load(P + i);
+		if (simd::all_within(x, FLT_MIN, FLT_MAX) && simd::all_within(y, -FLT_MAX, FLT_MAX))
+		{
+			// As ionization_table::get. Rounding down the clamped index is
+			// the same as clamping the rounded index, the bounds are integers.
+			const real true_x = simd::mul(simd::sub(simd_log<simd>(x), llow), linv);
+			const real true_y = simd::mul(simd::sub(y, plow), pinv);
+			const index K_index = simd::to_index(simd::max(zero, simd::min(true_x, max_x)));
+			const index P_index = simd::to_index(simd::max(zero, simd::min(true_y, max_y)));
+
+			real value = simd::gather(values, simd::add(simd::mul(K_index, row), P_index));
+			value = simd::select(simd::less(true_x, zero), none, value);
+			value = simd::select(simd::less(true_y, zero), none, value);
+			simd::store(out + i, value);
+			continue;
+		}
+		simd::leave();
+		simd_batch_rounddown_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step,
+			K + i, P + i, out + i, simd::width);
+	}
+	simd::leave();
+	simd_batch_rounddown_scalar(values, N_K, N_P, log_low, log_inv_step, P_low, P_inv_step,
+		K + i, P + i, out + i, n - i);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __SIMD_AVX2_H_
+#define __SIMD_AVX2_H_
+
+/*
+ * Vector operations for the batch kernels, AVX2 and FMA: 8 floats.
+ * Only include in translation units compiled with -mavx2 -mfma.
+ * See batch_kernels.h for the operations every instruction set provides.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+struct simd_avx2
+{
+	using real = __m256;
+	using index = __m256i;
+	using mask = __m256;
+	static constexpr size_t width = 8;
+	// Before calling scalar code: avoids the SSE transition penalty also in
+	// unoptimized builds, where the compiler does not insert it itself.
+	static void leave() { _mm256_zeroupper(); }
+
+
+	static real load(float const * p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, real x) { _mm256_storeu_ps(p, x); }
+	static real set1(float x) { return _mm256_set1_ps(x); }
+
+	static real add(real a, real b) { return _mm256_add_ps(a, b); }
+	static real sub(real a, real b) { return _mm256_sub_ps(a, b); }
+	static real mul(real a, real b) { return _mm256_mul_ps(a, b); }
+	// a*b + c, single rounding
+	static real fmadd(real a, real b, real c) { return _mm256_fmadd_ps(a, b, c); }
+	static real min(real a, real b) { return _mm256_min_ps(a, b); }
+	static real max(real a, real b) { return _mm256_max_ps(a, b); }
+	static real floor(real x) { return _mm256_floor_ps(x); }
+
+	static mask less(real a, real b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	// m ? a : b, per element
+	static real select(mask m, real a, real b) { return _mm256_blendv_ps(b, a, m); }
+	// True if low <= x <= high for all elements; false for NaN.
+	static bool all_within(real x, float low, float high)
+	{
+		const real in = _mm256_and_ps(
+			_mm256_cmp_ps(x, set1(low), _CMP_GE_OQ),
+			_mm256_cmp_ps(x, set1(high), _CMP_LE_OQ));
+		return _mm256_movemask_ps(in) == 0xff;
+	}
+
+	// Truncation towards zero, like a cast
+	static index to_index(real x) { return _mm256_cvttps_epi32(x); }
+	static real to_real(index i) { return _mm256_cvtepi32_ps(i); }
+	static index set1_index(int32_t i) { return _mm256_set1_epi32(i); }
+	static index add(index a, index b) { return _mm256_add_epi32(a, b); }
+	static index mul(index a, index b) { return _mm256_mullo_epi32(a, b); }
+	static real gather(float const * base, index i) { return _mm256_i32gather_ps(base, i, 4); }
+
+	// Split positive normal x into m * 2^e, with m in [0.5, 1).
+	static void split(real x, real & m, real & e)
+	{
+		const __m256i bits = _mm256_castps_si256(x);
+		e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+		m = _mm256_castsi256_ps(_mm256_or_si256(
+			_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)));
+	}
+	// x * 2^n, for integer n such that 2^n is a normal float.
+	static real scale2(real x, real n)
+	{
+		const __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+		return _mm256_mul_ps(x, _mm256_castsi256_ps(bits));
+	}
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __SIMD_AVX512_H_
+#define __SIMD_AVX512_H_
+
+/*
+ * Vector operations for the batch kernels, AVX-512F: 16 floats.
+ * Only include in translation units compiled with -mavx512f.
+ * See batch_kernels.h for the operations every instruction set provides.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+struct simd_avx512
+{
+	using real = __m512;
+	using index = __m512i;
+	using mask = __mmask16;
+	static constexpr size_t width = 16;
+	// Before calling scalar code: avoids the SSE transition penalty also in
+	// unoptimized builds, where the compiler does not insert it itself.
+	static void leave() { _mm256_zeroupper(); }
+
+
+	static real load(float const * p) { return _mm512_loadu_ps(p); }
+	static void store(float* p, real x) { _mm512_storeu_ps(p, x); }
+	static real set1(float x) { return _mm512_set1_ps(x); }
+
+	static real add(real a, real b) { return _mm512_add_ps(a, b); }
+	static real sub(real a, real b) { return _mm512_sub_ps(a, b); }
+	static real mul(real a, real b) { return _mm512_mul_ps(a, b); }
+	// a*b + c, single rounding
+	static real fmadd(real a, real b, real c) { return _mm512_fmadd_ps(a, b, c); }
+	static real min(real a, real b) { return _mm512_min_ps(a, b); }
+	static real max(real a, real b) { return _mm512_max_ps(a, b); }
+	static real floor(real x) { return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+	static mask less(real a, real b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	// m ? a : b, per element
+	static real select(mask m, real a, real b) { return _mm512_mask_blend_ps(m, b, a); }
+	// True if low <= x <= high for all elements; false for NaN.
+	static bool all_within(real x, float low, float high)
+	{
+		const mask in = _mm512_cmp_ps_mask(x, set1(low), _CMP_GE_OQ)
+			& _mm512_cmp_ps_mask(x, set1(high), _CMP_LE_OQ);
+		return in == 0xffff;
+	}
+
+	// Truncation towards zero, like a cast
+	static index to_index(real x) { return _mm512_cvttps_epi32(x); }
+	static real to_real(index i) { return _mm512_cvtepi32_ps(i); }
+	static index set1_index(int32_t i) { return _mm512_set1_epi32(i); }
+	static index add(index a, index b) { return _mm512_add_epi32(a, b); }
+	static index mul(index a, index b) { return _mm512_mullo_epi32(a, b); }
+	static real gather(float const * base, index i) { return _mm512_i32gather_ps(i, base, 4); }
+
+	// Split positive normal x into m * 2^e, with m in [0.5, 1).
+	static void split(real x, real & m, real & e)
+	{
+		const __m512i bits = _mm512_castps_si512(x);
+		e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+		m = _mm512_castsi512_ps(_mm512_or_si512(
+			_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f000000)));
+	}
+	// x * 2^n, for integer n such that 2^n is a normal float.
+	static real scale2(real x, real n)
+	{
+		const __m512i bits = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+		return _mm512_mul_ps(x, _mm512_castsi512_ps(bits));
+	}
+};
+
+#endif
@@ -5,6 +5,7 @@
  * Defines a 1D array with associated axis data.
  */
 
+#include <memory>
 #include <vector>
 
 template<typename datatype, typename ax>
@@ -13,12 +14,22 @@ class array1D_ax
 public:
 	using x_type = typename ax::value_type;
 	using value_type = datatype;
+	using math_policy = typename ax::math_policy;
 
 // Constructors & assignment
 	// Default-initialise data
 	inline array1D_ax(ax x_axis);
 	// Copy data
-	inline array1D_ax(ax x_axis, std::vector<value_type> values);
+	inline array1D_ax(ax x_axis, std::vector<value_type> const & values);
+	// Take ownership of data allocated with new[], holding x_axis.size() elements
+	inline array1D_ax(ax x_axis, std::unique_ptr<datatype[]> data);
+	// Refer to data owned by another object, which is kept alive by "owner".
+	// The data is not copied, except when this array is copied.
+	inline array1D_ax(ax x_axis, datatype* data, std::shared_ptr<void const> owner);
+	// Take over the data of an array on the same axis of another type, such
+	// as another math policy (math_policy.h). The data is not copied.
+	template<typename other_ax>
+	inline explicit array1D_ax(array1D_ax<datatype, other_ax> && rhs);
 	// Initialise to invalid state.
 	inline array1D_ax() = default;
 
@@ -34,10 +45,17 @@ public:
 	inline value_type const & operator()(size_t pos) const;
 
 	inline x_type get_x(size_t pos) const;
+	inline ax const & get_x_axis() const;
+
+	// Raw data, size() elements
+	inline datatype* data();
+	inline datatype const * data() const;
 
 	// Find the index corresponding to x.
 	// This is the "true index", i.e. potentially fractional and out-of-range.
 	inline x_type find_index(x_type x) const;
+	// Same, for a sweep over many x. See ax_list::find; start with hint = 0.
+	inline x_type find_index(x_type x, size_t & hint) const;
 
 	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
 	inline value_type at_linear(x_type x) const;
@@ -46,13 +64,27 @@ public:
 	// Same, but rounding to the largest stored element below x. If x is below the range, round up.
 	inline value_type at_rounddown(x_type x) const;
 
+	// Same as the above, given the true index from find_index.
+	// Log-log interpolation needs x as well.
+	inline value_type at_linear_index(x_type true_index) const;
+	inline value_type at_loglog_index(x_type x, x_type true_index) const;
+	inline value_type at_rounddown_index(x_type true_index) const;
+
 // Capacity
 	inline size_t size() const;
 	inline std::pair<value_type, value_type> get_xrange() const;
+	// False if the data is owned by another object, see the constructors.
+	inline bool owns_data() const;
 
 private:
 	ax _x_axis;
 	datatype* _data = nullptr;
+	std::shared_ptr<void const> _owner; // nullptr if _data is ours, allocated with new[]
+
+	inline void release();
+
+	template<typename, typename>
+	friend class array1D_ax;
 };
 
 #include "array1D_ax.inl"
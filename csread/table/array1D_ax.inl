@@ -1,28 +1,44 @@
 #include <algorithm>
 #include <cmath>
+#include <stdexcept>
 #include <tuple>
-#include "../clamp.h"
+#include "table_index.h"
 #include "array1D_ax.h"
 
 template<typename datatype, typename ax>
 array1D_ax<datatype, ax>::array1D_ax(ax x_axis) :
-	_x_axis(x_axis)
+	_x_axis(std::move(x_axis))
 {
 	_data = new datatype[size()]();
 }
 template<typename datatype, typename ax>
-array1D_ax<datatype, ax>::array1D_ax(ax x_axis, std::vector<value_type> values) :
-	_x_axis(x_axis)
+array1D_ax<datatype, ax>::array1D_ax(ax x_axis, std::vector<value_type> const & values) :
+	_x_axis(std::move(x_axis))
 {
-	if (x_axis.size() != values.size())
+	if (size() != values.size())
 		throw std::runtime_error("Unmatched dimensions between axis and values.");
 	_data = new datatype[size()];
 	std::copy(values.begin(), values.end(), _data);
 }
 template<typename datatype, typename ax>
+array1D_ax<datatype, ax>::array1D_ax(ax x_axis, std::unique_ptr<datatype[]> data) :
+	_x_axis(std::move(x_axis)), _data(data.release())
+{}
+template<typename datatype, typename ax>
+array1D_ax<datatype, ax>::array1D_ax(ax x_axis, datatype* data, std::shared_ptr<void const> owner) :
+	_x_axis(std::move(x_axis)), _data(data), _owner(std::move(owner))
+{}
+template<typename datatype, typename ax>
+template<typename other_ax>
+array1D_ax<datatype, ax>::array1D_ax(array1D_ax<datatype, other_ax> && rhs) :
+	_x_axis(rhs._x_axis), _data(rhs._data), _owner(std::move(rhs._owner))
+{
+	rhs._data = nullptr;
+}
+template<typename datatype, typename ax>
 array1D_ax<datatype, ax>::~array1D_ax()
 {
-	delete[] _data;
+	release();
 }
 template<typename datatype, typename ax>
 array1D_ax<datatype, ax>::array1D_ax(array1D_ax const & rhs) :
@@ -38,7 +54,7 @@ auto array1D_ax<datatype, ax>::operator=(array1D_ax const & rhs) -> array1D_ax&
 	if (this != &rhs)
 	{
 		_x_axis = rhs._x_axis;
-		delete[] _data;
+		release();
 
 		const auto sz = size();
 		_data = new datatype[sz];
@@ -48,7 +64,7 @@ auto array1D_ax<datatype, ax>::operator=(array1D_ax const & rhs) -> array1D_ax&
 }
 template<typename datatype, typename ax>
 array1D_ax<datatype, ax>::array1D_ax(array1D_ax && rhs) :
-	_x_axis(std::move(rhs._x_axis)), _data(rhs._data)
+	_x_axis(std::move(rhs._x_axis)), _data(rhs._data), _owner(std::move(rhs._owner))
 {
 	rhs._data = nullptr;
 }
@@ -59,8 +75,9 @@ auto array1D_ax<datatype, ax>::operator=(array1D_ax && rhs) -> array1D_ax&
 	{
 		_x_axis = std::move(rhs._x_axis);
 
-		delete[] _data;
+		release();
 		_data = rhs._data;
+		_owner = std::move(rhs._owner);
 		rhs._data = nullptr;
 	}
 	return *this;
@@ -78,27 +95,55 @@ auto array1D_ax<datatype, ax>::operator()(size_t pos) const -> value_type const
 	return _data[pos];
 }
 
+template<typename datatype, typename ax>
+datatype* array1D_ax<datatype, ax>::data()
+{
+	return _data;
+}
+
+template<typename datatype, typename ax>
+datatype const * array1D_ax<datatype, ax>::data() const
+{
+	return _data;
+}
+
 template<typename datatype, typename ax>
 auto array1D_ax<datatype, ax>::get_x(size_t pos) const -> x_type
 {
 	return _x_axis[pos];
 }
 
+template<typename datatype, typename ax>
+ax const & array1D_ax<datatype, ax>::get_x_axis() const
+{
+	return _x_axis;
+}
+
 template<typename datatype, typename ax>
 auto array1D_ax<datatype, ax>::find_index(x_type x) const -> x_type
 {
 	return _x_axis.find(x);
 }
 
+template<typename datatype, typename ax>
+auto array1D_ax<datatype, ax>::find_index(x_type x, size_t & hint) const -> x_type
+{
+	return _x_axis.find(x, hint);
+}
+
 template<typename datatype, typename ax>
 auto array1D_ax<datatype, ax>::at_linear(x_type x) const -> value_type
 {
-	const x_type true_index = _x_axis.find(x);
+	return at_linear_index(_x_axis.find(x));
+}
 
-	const size_t low_index = static_cast<size_t>(_clamp<value_type>(true_index, 0, _x_axis.size() - 2));
-	const x_type frac_index = true_index - low_index;
-	const datatype low_value = _data[low_index];
-	const datatype high_value = _data[low_index + 1];
+template<typename datatype, typename ax>
+auto array1D_ax<datatype, ax>::at_linear_index(x_type true_index) const -> value_type
+{
+	const linear_index<x_type> index(true_index, _x_axis.size());
+	const x_type frac_index = index.frac;
+	const datatype low_value = _data[index.low];
+	const datatype high_value = _data[index.low + 1];
 
 	/*
 	   FIXME: there is a potential problem if frac_index == 0 and high_value is infinite
@@ -111,27 +156,36 @@ auto array1D_ax<datatype, ax>::at_linear(x_type x) const -> value_type
 template<typename datatype, typename ax>
 auto array1D_ax<datatype, ax>::at_loglog(x_type x) const -> value_type
 {
-	const x_type true_index = _x_axis.find(x);
-	const size_t low_index = static_cast<size_t>(_clamp<value_type>(true_index, 0, _x_axis.size() - 2));
+	return at_loglog_index(x, _x_axis.find(x));
+}
 
-	const x_type frac_index = std::log(x / _x_axis[low_index]) / std::log(_x_axis[low_index + 1] / _x_axis[low_index]);
-	const datatype low_value = std::log(_data[low_index]);
-	const datatype high_value = std::log(_data[low_index + 1]);
+template<typename datatype, typename ax>
+auto array1D_ax<datatype, ax>::at_loglog_index(x_type x, x_type true_index) const -> value_type
+{
+	const size_t low_index = linear_index<x_type>(true_index, _x_axis.size()).low;
+
+	const x_type frac_index = math_policy::log(x / _x_axis[low_index]) / math_policy::log(_x_axis[low_index + 1] / _x_axis[low_index]);
+	const datatype low_value = math_policy::log(_data[low_index]);
+	const datatype high_value = math_policy::log(_data[low_index + 1]);
 
 	/*
 	   FIXME: there is a potential problem if frac_index == 0 and high_value is infinite
 	   or frac_index == 1 and low_value is infinite: 0 * inf == nan.
 	   In all other cases, infinities are handled correctly.
 	*/
-	return std::exp((1 - frac_index)*low_value + frac_index*high_value);
+	return math_policy::exp((1 - frac_index)*low_value + frac_index*high_value);
 }
 
 template<typename datatype, typename ax>
 auto array1D_ax<datatype, ax>::at_rounddown(x_type x) const -> value_type
 {
-	const x_type true_index = _x_axis.find(x);
-	const size_t rounded_index = static_cast<size_t>(_clamp<value_type>(true_index, 0, _x_axis.size() - 1));
-	return _data[rounded_index];
+	return at_rounddown_index(_x_axis.find(x));
+}
+
+template<typename datatype, typename ax>
+auto array1D_ax<datatype, ax>::at_rounddown_index(x_type true_index) const -> value_type
+{
+	return _data[rounddown_index(true_index, _x_axis.size())];
 }
 
 template<typename datatype, typename ax>
@@ -145,3 +199,18 @@ auto array1D_ax<datatype, ax>::get_xrange() const -> std::pair<value_type, value
 {
 	return{ _x_axis[0], _x_axis[size() - 1] };
 }
+
+template<typename datatype, typename ax>
+bool array1D_ax<datatype, ax>::owns_data() const
+{
+	return _owner == nullptr;
+}
+
+template<typename datatype, typename ax>
+void array1D_ax<datatype, ax>::release()
+{
+	if (_owner == nullptr)
+		delete[] _data;
+	_owner.reset();
+	_data = nullptr;
+}
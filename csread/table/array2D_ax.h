@@ -5,6 +5,9 @@
  * Defines a 2D array with associated axis data.
  */
 
+#include <memory>
+#include <vector>
+
 template<typename datatype, typename ax_x, typename ax_y>
 class array2D_ax
 {
@@ -12,12 +15,22 @@ public:
 	using x_type = typename ax_x::value_type;
 	using y_type = typename ax_y::value_type;
 	using value_type = datatype;
+	using math_policy = typename ax_x::math_policy;
 
 // Constructors
 	// Default-initialise data
 	inline array2D_ax(ax_x x_axis, ax_y y_axis);
 	// Copy data. Values are indexed as [x_index*height() + y_index]
-	inline array2D_ax(ax_x x_axis, ax_y y_axis, std::vector<value_type> values);
+	inline array2D_ax(ax_x x_axis, ax_y y_axis, std::vector<value_type> const & values);
+	// Take ownership of data allocated with new[], holding width()*height() elements, indexed as above
+	inline array2D_ax(ax_x x_axis, ax_y y_axis, std::unique_ptr<datatype[]> data);
+	// Refer to data owned by another object, which is kept alive by "owner".
+	// The data is not copied, except when this array is copied.
+	inline array2D_ax(ax_x x_axis, ax_y y_axis, datatype* data, std::shared_ptr<void const> owner);
+	// Take over the data of an array on the same axes of other types, such
+	// as another math policy (math_policy.h). The data is not copied.
+	template<typename other_ax_x, typename other_ax_y>
+	inline explicit array2D_ax(array2D_ax<datatype, other_ax_x, other_ax_y> && rhs);
 	// Initialise to invalid state.
 	inline array2D_ax() = default;
 
@@ -34,11 +47,20 @@ public:
 
 	inline x_type get_x(size_t pos_x) const;
 	inline y_type get_y(size_t pos_y) const;
+	inline ax_x const & get_x_axis() const;
+	inline ax_y const & get_y_axis() const;
+
+	// Raw data, size() elements, indexed as [x_index*height() + y_index]
+	inline datatype* data();
+	inline datatype const * data() const;
 
 	// Find the index corresponding to x and y.
 	// This is the "true index", i.e. potentially fractional and out-of-range.
 	inline x_type find_x(x_type x) const;
 	inline y_type find_y(y_type y) const;
+	// Same, for a sweep over many x or y. See ax_list::find; start with hint = 0.
+	inline x_type find_x(x_type x, size_t & hint) const;
+	inline y_type find_y(y_type y, size_t & hint) const;
 
 	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
 	inline value_type at_linear(x_type x, y_type y) const;
@@ -46,6 +68,11 @@ public:
 	// Same, but rounding to the largest stored element below the requested one. If x or y is below the range, round up.
 	inline value_type at_rounddown(x_type x, y_type y) const;
 
+	// Same as at_linear and at_rounddown, given true indices from find_x and find_y.
+	// Saves the search when many points share a coordinate.
+	inline value_type at_linear_index(x_type true_x, y_type true_y) const;
+	inline value_type at_rounddown_index(x_type true_x, y_type true_y) const;
+
 // Capacity
 	inline size_t width() const;
 	inline size_t height() const;
@@ -53,11 +80,19 @@ public:
 
 	inline std::pair<value_type, value_type> get_xrange() const;
 	inline std::pair<value_type, value_type> get_yrange() const;
+	// False if the data is owned by another object, see the constructors.
+	inline bool owns_data() const;
 
 private:
 	ax_x _x_axis;
 	ax_y _y_axis;
 	datatype* _data = nullptr;
+	std::shared_ptr<void const> _owner; // nullptr if _data is ours, allocated with new[]
+
+	inline void release();
+
+	template<typename, typename, typename>
+	friend class array2D_ax;
 };
 
 #include "array2D_ax.inl"
@@ -1,27 +1,43 @@
 #include <algorithm>
 #include <cmath>
-#include "../clamp.h"
+#include <stdexcept>
 #include "array2D_ax.h"
+#include "table_index.h"
 
 template<typename datatype, typename ax_x, typename ax_y>
 array2D_ax<datatype, ax_x, ax_y>::array2D_ax(ax_x x_axis, ax_y y_axis) :
-	_x_axis(x_axis), _y_axis(y_axis)
+	_x_axis(std::move(x_axis)), _y_axis(std::move(y_axis))
 {
-	_data = new datatype[x_axis.size()*y_axis.size()]();
+	_data = new datatype[size()]();
 }
 template<typename datatype, typename ax_x, typename ax_y>
-array2D_ax<datatype, ax_x, ax_y>::array2D_ax(ax_x x_axis, ax_y y_axis, std::vector<value_type> values) :
-	_x_axis(x_axis), _y_axis(y_axis)
+array2D_ax<datatype, ax_x, ax_y>::array2D_ax(ax_x x_axis, ax_y y_axis, std::vector<value_type> const & values) :
+	_x_axis(std::move(x_axis)), _y_axis(std::move(y_axis))
 {
-	if (x_axis.size()*y_axis.size() != values.size())
+	if (size() != values.size())
 		throw std::runtime_error("Unmatched dimensions between axes and values.");
 	_data = new datatype[size()];
 	std::copy(values.begin(), values.end(), _data);
 }
 template<typename datatype, typename ax_x, typename ax_y>
+array2D_ax<datatype, ax_x, ax_y>::array2D_ax(ax_x x_axis, ax_y y_axis, std::unique_ptr<datatype[]> data) :
+	_x_axis(std::move(x_axis)), _y_axis(std::move(y_axis)), _data(data.release())
+{}
+template<typename datatype, typename ax_x, typename ax_y>
+array2D_ax<datatype, ax_x, ax_y>::array2D_ax(ax_x x_axis, ax_y y_axis, datatype* data, std::shared_ptr<void const> owner) :
+	_x_axis(std::move(x_axis)), _y_axis(std::move(y_axis)), _data(data), _owner(std::move(owner))
+{}
+template<typename datatype, typename ax_x, typename ax_y>
+template<typename other_ax_x, typename other_ax_y>
+array2D_ax<datatype, ax_x, ax_y>::array2D_ax(array2D_ax<datatype, other_ax_x, other_ax_y> && rhs) :
+	_x_axis(rhs._x_axis), _y_axis(rhs._y_axis), _data(rhs._data), _owner(std::move(rhs._owner))
+{
+	rhs._data = nullptr;
+}
+template<typename datatype, typename ax_x, typename ax_y>
 array2D_ax<datatype, ax_x, ax_y>::~array2D_ax()
 {
-	delete[] _data;
+	release();
 }
 template<typename datatype, typename ax_x, typename ax_y>
 array2D_ax<datatype, ax_x, ax_y>::array2D_ax(array2D_ax const & rhs) :
@@ -38,7 +54,7 @@ auto array2D_ax<datatype, ax_x, ax_y>::operator=(array2D_ax const & rhs) -> arra
 	{
 		_x_axis = rhs._x_axis;
 		_y_axis = rhs._y_axis;
-		delete[] _data;
+		release();
 
 		const auto sz = size();
 		_data = new datatype[sz];
@@ -48,7 +64,7 @@ auto array2D_ax<datatype, ax_x, ax_y>::operator=(array2D_ax const & rhs) -> arra
 }
 template<typename datatype, typename ax_x, typename ax_y>
 array2D_ax<datatype, ax_x, ax_y>::array2D_ax(array2D_ax && rhs) :
-	_x_axis(std::move(rhs._x_axis)), _y_axis(std::move(rhs._y_axis)), _data(rhs._data)
+	_x_axis(std::move(rhs._x_axis)), _y_axis(std::move(rhs._y_axis)), _data(rhs._data), _owner(std::move(rhs._owner))
 {
 	rhs._data = nullptr;
 }
@@ -60,8 +76,9 @@ auto array2D_ax<datatype, ax_x, ax_y>::operator=(array2D_ax && rhs) -> array2D_a
 		_x_axis = std::move(rhs._x_axis);
 		_y_axis = std::move(rhs._y_axis);
 
-		delete[] _data;
+		release();
 		_data = rhs._data;
+		_owner = std::move(rhs._owner);
 		rhs._data = nullptr;
 	}
 	return *this;
@@ -79,6 +96,17 @@ auto array2D_ax<datatype, ax_x, ax_y>::operator()(size_t pos_x, size_t pos_y) co
 	return _data[pos_x*height() + pos_y];
 }
 
+template<typename datatype, typename ax_x, typename ax_y>
+datatype* array2D_ax<datatype, ax_x, ax_y>::data()
+{
+	return _data;
+}
+template<typename datatype, typename ax_x, typename ax_y>
+datatype const * array2D_ax<datatype, ax_x, ax_y>::data() const
+{
+	return _data;
+}
+
 template<typename datatype, typename ax_x, typename ax_y>
 auto array2D_ax<datatype, ax_x, ax_y>::get_x(size_t pos_x) const -> x_type
 {
@@ -90,6 +118,17 @@ auto array2D_ax<datatype, ax_x, ax_y>::get_y(size_t pos_y) const -> y_type
 	return _y_axis[pos_y];
 }
 
+template<typename datatype, typename ax_x, typename ax_y>
+ax_x const & array2D_ax<datatype, ax_x, ax_y>::get_x_axis() const
+{
+	return _x_axis;
+}
+template<typename datatype, typename ax_x, typename ax_y>
+ax_y const & array2D_ax<datatype, ax_x, ax_y>::get_y_axis() const
+{
+	return _y_axis;
+}
+
 template<typename datatype, typename ax_x, typename ax_y>
 auto array2D_ax<datatype, ax_x, ax_y>::find_x(x_type x) const -> x_type
 {
@@ -102,21 +141,36 @@ auto array2D_ax<datatype, ax_x, ax_y>::find_y(y_type y) const -> y_type
 	return _y_axis.find(y);
 }
 
+template<typename datatype, typename ax_x, typename ax_y>
+auto array2D_ax<datatype, ax_x, ax_y>::find_x(x_type x, size_t & hint) const -> x_type
+{
+	return _x_axis.find(x, hint);
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto array2D_ax<datatype, ax_x, ax_y>::find_y(y_type y, size_t & hint) const -> y_type
+{
+	return _y_axis.find(y, hint);
+}
+
 template<typename datatype, typename ax_x, typename ax_y>
 auto array2D_ax<datatype, ax_x, ax_y>::at_linear(x_type x, y_type y) const -> value_type
 {
-	const x_type true_x = _x_axis.find(x);
-	const y_type true_y = _y_axis.find(y);
+	return at_linear_index(_x_axis.find(x), _y_axis.find(y));
+}
 
-	const size_t low_x = static_cast<size_t>(_clamp<value_type>(true_x, 0, _x_axis.size()-2));
-	const x_type frac_x = true_x - low_x;
-	const size_t low_y = static_cast<size_t>(_clamp<value_type>(true_y, 0, _y_axis.size()-2));
-	const y_type frac_y = true_y - low_y;
+template<typename datatype, typename ax_x, typename ax_y>
+auto array2D_ax<datatype, ax_x, ax_y>::at_linear_index(x_type true_x, y_type true_y) const -> value_type
+{
+	const linear_index<x_type> index_x(true_x, _x_axis.size());
+	const linear_index<y_type> index_y(true_y, _y_axis.size());
+	const x_type frac_x = index_x.frac;
+	const y_type frac_y = index_y.frac;
 
-	const datatype v00 = (*this)(low_x, low_y);
-	const datatype v10 = (*this)(low_x + 1, low_y);
-	const datatype v01 = (*this)(low_x, low_y + 1);
-	const datatype v11 = (*this)(low_x + 1, low_y + 1);
+	const datatype v00 = (*this)(index_x.low, index_y.low);
+	const datatype v10 = (*this)(index_x.low + 1, index_y.low);
+	const datatype v01 = (*this)(index_x.low, index_y.low + 1);
+	const datatype v11 = (*this)(index_x.low + 1, index_y.low + 1);
 
 	/*
 	   FIXME: there is a potential problem if frac_x/y == 0 or 1
@@ -133,13 +187,13 @@ auto array2D_ax<datatype, ax_x, ax_y>::at_linear(x_type x, y_type y) const -> va
 template<typename datatype, typename ax_x, typename ax_y>
 auto array2D_ax<datatype, ax_x, ax_y>::at_rounddown(x_type x, y_type y) const -> value_type
 {
-	const x_type true_x = _x_axis.find(x);
-	const y_type true_y = _y_axis.find(y);
-
-	size_t rounded_x = static_cast<size_t>(_clamp<value_type>(true_x, 0, _x_axis.size() - 1));
-	size_t rounded_y = static_cast<size_t>(_clamp<value_type>(true_y, 0, _y_axis.size() - 1));
+	return at_rounddown_index(_x_axis.find(x), _y_axis.find(y));
+}
 
-	return (*this)(rounded_x, rounded_y);
+template<typename datatype, typename ax_x, typename ax_y>
+auto array2D_ax<datatype, ax_x, ax_y>::at_rounddown_index(x_type true_x, y_type true_y) const -> value_type
+{
+	return (*this)(rounddown_index(true_x, _x_axis.size()), rounddown_index(true_y, _y_axis.size()));
 }
 
 template<typename datatype, typename ax_x, typename ax_y>
@@ -171,3 +225,18 @@ auto array2D_ax<datatype, ax_x, ax_y>::get_yrange() const -> std::pair<value_typ
 {
 	return{ _y_axis[0], _y_axis[height() - 1] };
 }
+
+template<typename datatype, typename ax_x, typename ax_y>
+bool array2D_ax<datatype, ax_x, ax_y>::owns_data() const
+{
+	return _owner == nullptr;
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+void array2D_ax<datatype, ax_x, ax_y>::release()
+{
+	if (_owner == nullptr)
+		delete[] _data;
+	_owner.reset();
+	_data = nullptr;
+}
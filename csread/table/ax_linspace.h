@@ -8,23 +8,28 @@
  * 
  * Note: due to round-off errors, linspace[N-1]
  * is not always exactly equal to high.
+ *
+ * The inverse step is stored, so that find() needs no division.
+ * See ax_unit_interval.h for the common case of [0, 1].
  */
 
 #include <algorithm>
+#include "math_policy.h"
 
 template<typename datatype>
 class ax_linspace
 {
 public:
 	using value_type = datatype;
+	using math_policy = exact_math; // For tables on this axis
 
 	// Initialise to invalid state.
 	ax_linspace()
-		: _low(0), _step(0), _N(0)
+		: _low(0), _step(0), _inv_step(0), _N(0)
 	{}
 
 	ax_linspace(value_type low, value_type high, size_t N)
-		: _low(low), _step((high - low) / (N - 1)), _N(N)
+		: _low(low), _step((high - low) / (N - 1)), _inv_step((N - 1) / (high - low)), _N(N)
 	{}
 
 	datatype operator[](size_t pos) const
@@ -41,12 +46,33 @@ public:
 	// Return fractional index, which is potentially out of range
 	value_type find(value_type x) const
 	{
-		return (x - _low) / _step;
+		return (x - _low) * _inv_step;
+	}
+
+	// Same, for a sweep over many x; see ax_list. No search is needed here.
+	value_type find(value_type x, size_t & /*hint*/) const
+	{
+		return find(x);
+	}
+
+	// Parameters of find(x) = (x - low()) * inv_step(), for vectorized lookups
+	value_type low() const
+	{
+		return _low;
+	}
+	value_type step() const
+	{
+		return _step;
+	}
+	value_type inv_step() const
+	{
+		return _inv_step;
 	}
 
 private:
 	value_type _low;
 	value_type _step;
+	value_type _inv_step;
 	size_t _N;
 };
 
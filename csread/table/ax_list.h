@@ -3,41 +3,120 @@
 
 /*
  * Axis representation as array of consecutive values.
+ *
+ * The values are immutable and reference counted: copies of an axis, and
+ * therefore tables built on the same axis, share one buffer.
  */
 
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include "../clamp.h"
+#include "math_policy.h"
 
 template<typename datatype>
-class ax_list : public std::vector<datatype>
+class ax_list
 {
 public:
-	using base_type = std::vector<datatype>;
 	using value_type = datatype;
-
-	using base_type::size;
+	using math_policy = exact_math; // For tables on this axis
 
 	ax_list() = default;
 	ax_list(std::vector<datatype> const & data) :
-		base_type(data)
+		ax_list(std::vector<datatype>(data))
 	{}
-	ax_list(size_t size) :
-		base_type(size)
+	ax_list(std::vector<datatype> && data) :
+		_storage(std::make_shared<std::vector<datatype> const>(std::move(data))),
+		_data(_storage->data()), _size(_storage->size())
 	{}
 
+	// Copies share the values. A moved-from axis is empty.
+	ax_list(ax_list const &) = default;
+	ax_list& operator=(ax_list const &) = default;
+	ax_list(ax_list && rhs) :
+		_storage(std::move(rhs._storage)), _data(rhs._data), _size(rhs._size)
+	{
+		rhs._data = nullptr;
+		rhs._size = 0;
+	}
+	ax_list& operator=(ax_list && rhs)
+	{
+		if (this != &rhs)
+		{
+			_storage = std::move(rhs._storage);
+			_data = rhs._data;
+			_size = rhs._size;
+			rhs._data = nullptr;
+			rhs._size = 0;
+		}
+		return *this;
+	}
+
+	value_type const & operator[](size_t i) const
+	{
+		return _data[i];
+	}
+	size_t size() const
+	{
+		return _size;
+	}
+	value_type const * data() const
+	{
+		return _data;
+	}
+	value_type const * begin() const
+	{
+		return _data;
+	}
+	value_type const * end() const
+	{
+		return _data + _size;
+	}
+
+	// True if both axes refer to the same buffer, so that they are equal and
+	// an index found on one is valid on the other.
+	bool shares_storage(ax_list const & other) const
+	{
+		return _storage != nullptr && _storage == other._storage;
+	}
+
 	// Find the position of x in this logspace.
 	// Return [in range, fractional index]
 	value_type find(datatype x) const
 	{
-		// Estimate true index, even if out of range.
-		const auto high_iterator = std::lower_bound(base_type::begin(), base_type::end(), x);
-		const size_t high_index = _clamp<size_t>(std::distance(base_type::begin(), high_iterator), 1, size() - 1);
-		const value_type high_value = (*this)[high_index];
-		const value_type low_value = (*this)[high_index - 1];
-		const value_type true_index = high_index + (x - high_value) / (high_value - low_value);
+		const auto high_iterator = std::lower_bound(begin(), end(), x);
+		return true_index(std::distance(begin(), high_iterator), x);
+	}
+
+	// Same, for a sweep over many x. The search starts at "hint", which is
+	// updated for the next call; start a sweep with hint = 0. For sorted x,
+	// a sweep costs O(number of x + size()) instead of O(number of x * log size()).
+	// Gives exactly the same result as find(x), also if x is not sorted.
+	value_type find(datatype x, size_t & hint) const
+	{
+		// Move to the first element not less than x, like std::lower_bound.
+		size_t pos = std::min(hint, size());
+		while (pos < size() && _data[pos] < x)
+			++pos;
+		while (pos > 0 && !(_data[pos - 1] < x))
+			--pos;
+		hint = pos;
+		return true_index(pos, x);
+	}
+
+private:
+	std::shared_ptr<std::vector<datatype> const> _storage;
+	// Cached from _storage, saves an indirection on lookups
+	value_type const * _data = nullptr;
+	size_t _size = 0;
 
-		return true_index;
+	// Estimate true index from the first element not less than x, even if out of range.
+	value_type true_index(size_t lower_bound_index, datatype x) const
+	{
+		const size_t high_index = _clamp<size_t>(lower_bound_index, 1, size() - 1);
+		const value_type high_value = _data[high_index];
+		const value_type low_value = _data[high_index - 1];
+		return high_index + (x - high_value) / (high_value - low_value);
 	}
 };
 
@@ -7,31 +7,58 @@
  * 
  * Note: due to round-off errors, logspace[N-1]
  * is not always exactly equal to high.
+ *
+ * The math policy (see math_policy.h) selects the log() used by find().
+ * The inverse step is stored, so that find() needs no division.
+ *
+ * operator[] calls exp(). If it is needed often, cache_nodes() stores all
+ * points instead; copies of the axis share them.
  */
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
+#include "math_policy.h"
 
-template<typename datatype>
+template<typename datatype, typename math = exact_math>
 class ax_logspace
 {
 public:
 	using value_type = datatype;
+	using math_policy = math;
 
 	// Initialise to invalid state.
 	ax_logspace()
-		: _llow(0), _lstep(0), _N(0)
+		: _llow(0), _lstep(0), _inv_lstep(0), _N(0)
 	{}
 
 	ax_logspace(value_type low, value_type high, size_t N)
-		: _llow(std::log(low)), _lstep(std::log(high/low) / (N - 1)), _N(N)
+		: _llow(std::log(low)), _lstep(std::log(high/low) / (N - 1)), _inv_lstep((N - 1) / std::log(high/low)), _N(N)
+	{}
+
+	// The same axis with another math policy
+	template<typename other_math>
+	explicit ax_logspace(ax_logspace<datatype, other_math> const & other)
+		: _llow(other._llow), _lstep(other._lstep), _inv_lstep(other._inv_lstep), _N(other._N), _nodes(other._nodes)
 	{}
 
 	datatype operator[](size_t pos) const
 	{
+		if (_nodes)
+			return (*_nodes)[pos];
 		return std::exp(_llow + _lstep*pos);
 	}
 
+	// Compute all points once, for operator[]. The values do not change.
+	void cache_nodes()
+	{
+		std::shared_ptr<std::vector<datatype>> nodes(new std::vector<datatype>(_N));
+		for (size_t pos = 0; pos < _N; ++pos)
+			(*nodes)[pos] = std::exp(_llow + _lstep*pos);
+		_nodes = std::move(nodes);
+	}
+
 	size_t size() const
 	{
 		return _N;
@@ -41,13 +68,38 @@ public:
 	// Return fractional index, which is potentially out of range
 	value_type find(value_type x) const
 	{
-		return (std::log(x) - _llow) / _lstep;
+		return (math::log(x) - _llow) * _inv_lstep;
+	}
+
+	// Same, for a sweep over many x; see ax_list. No search is needed here.
+	value_type find(value_type x, size_t & /*hint*/) const
+	{
+		return find(x);
+	}
+
+	// Parameters of find(x) = (log(x) - log_low()) * log_inv_step(), for vectorized lookups
+	value_type log_low() const
+	{
+		return _llow;
+	}
+	value_type log_step() const
+	{
+		return _lstep;
+	}
+	value_type log_inv_step() const
+	{
+		return _inv_lstep;
 	}
 
 private:
 	value_type _llow;
 	value_type _lstep;
+	value_type _inv_lstep;
 	size_t _N;
+	std::shared_ptr<std::vector<datatype> const> _nodes; // See cache_nodes()
+
+	template<typename, typename>
+	friend class ax_logspace;
 };
 
 #endif
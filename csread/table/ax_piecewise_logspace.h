@@ -0,0 +1,147 @@
+#ifndef __AX_PIECEWISE_LOGSPACE_H_
+#define __AX_PIECEWISE_LOGSPACE_H_
+
+/*
+ * Axis representation as consecutive log spaced segments, each with its own
+ * density. For example, edges {1, 100, 50000} with intervals {200, 100} puts
+ * 200 intervals between 1 and 100, and 100 between 100 and 50000. Neighbouring
+ * segments share their edge point, so there are 1 + sum(intervals) points.
+ *
+ * find() costs one log, no division, and is independent of the number of
+ * points. The segment is looked up in a table of equal buckets in log(x);
+ * there are enough buckets for one segment edge per bucket, up to
+ * max_buckets, so that at most one edge is compared to in all but the
+ * narrowest segments. Out of range, the first or last segment is extrapolated.
+ *
+ * Note: due to round-off errors, points are not always exactly equal to the edges.
+ *
+ * The math policy (see math_policy.h) selects the log() used by find().
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "math_policy.h"
+#include "table_index.h"
+
+template<typename datatype, typename math = exact_math>
+class ax_piecewise_logspace
+{
+public:
+	using value_type = datatype;
+	using math_policy = math;
+
+	// Initialise to invalid state.
+	ax_piecewise_logspace() = default;
+
+	// edges must be positive and increasing; intervals has one element less
+	// than edges, all nonzero.
+	ax_piecewise_logspace(std::vector<value_type> const & edges, std::vector<size_t> const & intervals)
+		: _edges(edges), _intervals(intervals)
+	{
+		if (edges.size() < 2 || intervals.size() != edges.size() - 1)
+			throw std::runtime_error("Piecewise axis needs one more edge than segments.");
+
+		size_t first = 0;
+		for (size_t s = 0; s < intervals.size(); ++s)
+		{
+			if (!(edges[s] > 0 && edges[s + 1] > edges[s]) || intervals[s] == 0)
+				throw std::runtime_error("Invalid segment in piecewise axis.");
+			const value_type llow = std::log(edges[s]);
+			const value_type lwidth = std::log(edges[s + 1] / edges[s]);
+			_segments.push_back({ llow, lwidth / intervals[s], intervals[s] / lwidth, first });
+			first += intervals[s];
+		}
+		_N = first + 1;
+
+		// Buckets for find(). A bucket starts at the first segment whose low
+		// edge is in an earlier bucket: find() maps all x at or above that edge
+		// to a later bucket, as it uses the same, monotonic, computation.
+		const value_type lwidth = std::log(edges.back()) - _segments.front().llow;
+		value_type min_lwidth = lwidth;
+		for (size_t s = 0; s < intervals.size(); ++s)
+			min_lwidth = std::min<value_type>(min_lwidth, std::log(edges[s + 1] / edges[s]));
+		const size_t N_buckets = static_cast<size_t>(std::min<double>(max_buckets, std::ceil(lwidth / min_lwidth)));
+		_inv_bucket_width = N_buckets / lwidth;
+		_buckets.assign(N_buckets, 0);
+		for (size_t s = 1; s < _segments.size(); ++s)
+		{
+			for (size_t b = bucket(_segments[s].llow) + 1; b < N_buckets; ++b)
+				++_buckets[b];
+		}
+	}
+
+	// The same axis with another math policy
+	template<typename other_math>
+	explicit ax_piecewise_logspace(ax_piecewise_logspace<datatype, other_math> const & other)
+		: ax_piecewise_logspace(other.get_edges(), other.get_intervals())
+	{}
+
+	datatype operator[](size_t pos) const
+	{
+		// Last segment whose first point is at or before pos
+		const size_t s = std::upper_bound(_segments.begin() + 1, _segments.end(), pos,
+			[](size_t p, segment_t const & segment) { return p < segment.first; }) - _segments.begin() - 1;
+		return std::exp(_segments[s].llow + _segments[s].lstep*(pos - _segments[s].first));
+	}
+
+	size_t size() const
+	{
+		return _N;
+	}
+
+	// Find the position of x in this axis.
+	// Return fractional index, which is potentially out of range
+	value_type find(value_type x) const
+	{
+		const value_type lx = math::log(x);
+		size_t s = _buckets[bucket(lx)];
+		while (s + 1 < _segments.size() && !(lx < _segments[s + 1].llow))
+			++s;
+		return _segments[s].first + (lx - _segments[s].llow) * _segments[s].inv_lstep;
+	}
+
+	// Same, for a sweep over many x; see ax_list. No search is needed here.
+	value_type find(value_type x, size_t & /*hint*/) const
+	{
+		return find(x);
+	}
+
+	// Parameters, as given to the constructor
+	std::vector<value_type> const & get_edges() const
+	{
+		return _edges;
+	}
+	std::vector<size_t> const & get_intervals() const
+	{
+		return _intervals;
+	}
+
+	// Largest number of buckets used by find()
+	static const size_t max_buckets = 1024;
+
+private:
+	struct segment_t
+	{
+		value_type llow;      // Log of the first point
+		value_type lstep;     // Log of the ratio between points
+		value_type inv_lstep; // 1 / lstep, for find()
+		size_t first;         // Index of the first point
+	};
+
+	std::vector<value_type> _edges;
+	std::vector<size_t> _intervals;
+	std::vector<segment_t> _segments;
+	size_t _N = 0;
+
+	std::vector<size_t> _buckets; // First segment that may contain log(x), per bucket
+	value_type _inv_bucket_width = 0;
+
+	size_t bucket(value_type lx) const
+	{
+		return rounddown_index((lx - _segments.front().llow) * _inv_bucket_width, _buckets.size());
+	}
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef __AX_UNIT_INTERVAL_H_
+#define __AX_UNIT_INTERVAL_H_
+
+/*
+ * Axis representation as linearly spaced array on [0, 1], with N points
+ * pos / (N-1); the end points are exactly 0 and 1. Used for the probability
+ * axis of ICDF tables, where find() is a single multiplication by N-1.
+ */
+
+#include "math_policy.h"
+
+template<typename datatype>
+class ax_unit_interval
+{
+public:
+	using value_type = datatype;
+	using math_policy = exact_math; // For tables on this axis
+
+	// Initialise to invalid state.
+	ax_unit_interval()
+		: _step(0), _intervals(0), _N(0)
+	{}
+
+	explicit ax_unit_interval(size_t N)
+		: _step(value_type(1) / (N - 1)), _intervals(static_cast<value_type>(N - 1)), _N(N)
+	{}
+
+	datatype operator[](size_t pos) const
+	{
+		// Division, rather than _step*pos, which falls just short of 1 for many N
+		return pos == _N - 1 ? value_type(1) : pos / _intervals;
+	}
+
+	size_t size() const
+	{
+		return _N;
+	}
+
+	// Find the position of x in this axis.
+	// Return fractional index, which is potentially out of range
+	value_type find(value_type x) const
+	{
+		return x * _intervals;
+	}
+
+	// Same, for a sweep over many x; see ax_list. No search is needed here.
+	value_type find(value_type x, size_t & /*hint*/) const
+	{
+		return find(x);
+	}
+
+	// Parameters of find(x) = (x - low()) * inv_step(), as for ax_linspace
+	value_type low() const
+	{
+		return 0;
+	}
+	value_type step() const
+	{
+		return _step;
+	}
+	value_type inv_step() const
+	{
+		return _intervals;
+	}
+
+private:
+	value_type _step;
+	value_type _intervals; // N-1, exact
+	size_t _N;
+};
+
+#endif
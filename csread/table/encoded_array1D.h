@@ -0,0 +1,62 @@
+#ifndef __ENCODED_ARRAY1D_H_
+#define __ENCODED_ARRAY1D_H_
+
+/*
+ * 1D array with associated axis data, like array1D_ax, but with the values
+ * stored in a compact encoding; see table_encoding.h.
+ * Values are decoded when they are accessed. The array cannot be modified.
+ */
+
+#include <memory>
+#include <type_traits>
+#include "array1D_ax.h"
+#include "table_encoding.h"
+
+template<typename datatype, typename encoding, typename ax>
+class encoded_array1D
+{
+	static_assert(std::is_same<datatype, float>::value, "Encoded arrays hold single precision values.");
+
+public:
+	using x_type = typename ax::value_type;
+	using value_type = datatype;
+	using codec_type = table_encoding::codec<encoding>;
+	using stored_type = typename codec_type::stored_type;
+
+// Constructors
+	// Encode the values of an array.
+	inline encoded_array1D(array1D_ax<datatype, ax> const & source);
+	// Initialise to invalid state.
+	inline encoded_array1D() = default;
+
+	inline encoded_array1D(encoded_array1D &&) = default;
+	inline encoded_array1D& operator=(encoded_array1D &&) = default;
+
+// Element access
+	// Decoded element, unchecked bounds
+	inline value_type operator()(size_t pos) const;
+
+	inline x_type get_x(size_t pos) const;
+
+	// Find the index corresponding to x, see array1D_ax.
+	inline x_type find_index(x_type x) const;
+
+	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
+	inline value_type at_linear(x_type x) const;
+
+	// Largest absolute difference between a decoded value and the original one.
+	inline value_type get_encoding_error() const;
+
+// Capacity
+	inline size_t size() const;
+
+private:
+	ax _x_axis;
+	std::unique_ptr<stored_type[]> _data;
+	typename codec_type::row_type _row{};
+	value_type _encoding_error = 0;
+};
+
+#include "encoded_array1D.inl"
+
+#endif
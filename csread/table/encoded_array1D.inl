@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "encoded_array1D.h"
+#include "table_index.h"
+
+template<typename datatype, typename encoding, typename ax>
+encoded_array1D<datatype, encoding, ax>::encoded_array1D(array1D_ax<datatype, ax> const & source) :
+	_x_axis(source.get_x_axis()), _data(new stored_type[source.size()])
+{
+	const size_t N = source.size();
+	_row = codec_type::make_row(source.data(), N);
+	for (size_t i = 0; i < N; ++i)
+	{
+		_data[i] = codec_type::encode(source(i), _row);
+		_encoding_error = std::max<value_type>(_encoding_error,
+			table_encoding::encoding_error(source(i), (*this)(i)));
+	}
+}
+
+template<typename datatype, typename encoding, typename ax>
+auto encoded_array1D<datatype, encoding, ax>::operator()(size_t pos) const -> value_type
+{
+	return codec_type::decode(_data[pos], _row);
+}
+
+template<typename datatype, typename encoding, typename ax>
+auto encoded_array1D<datatype, encoding, ax>::get_x(size_t pos) const -> x_type
+{
+	return _x_axis[pos];
+}
+
+template<typename datatype, typename encoding, typename ax>
+auto encoded_array1D<datatype, encoding, ax>::find_index(x_type x) const -> x_type
+{
+	return _x_axis.find(x);
+}
+
+template<typename datatype, typename encoding, typename ax>
+auto encoded_array1D<datatype, encoding, ax>::at_linear(x_type x) const -> value_type
+{
+	const linear_index<x_type> index(_x_axis.find(x), _x_axis.size());
+	const x_type frac_index = index.frac;
+	const value_type low_value = (*this)(index.low);
+	const value_type high_value = (*this)(index.low + 1);
+
+	return (1 - frac_index)*low_value + frac_index*high_value;
+}
+
+template<typename datatype, typename encoding, typename ax>
+auto encoded_array1D<datatype, encoding, ax>::get_encoding_error() const -> value_type
+{
+	return _encoding_error;
+}
+
+template<typename datatype, typename encoding, typename ax>
+size_t encoded_array1D<datatype, encoding, ax>::size() const
+{
+	return _x_axis.size();
+}
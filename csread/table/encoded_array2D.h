@@ -0,0 +1,71 @@
+#ifndef __ENCODED_ARRAY2D_H_
+#define __ENCODED_ARRAY2D_H_
+
+/*
+ * 2D array with associated axis data, like array2D_ax, but with the values
+ * stored in a compact encoding; see table_encoding.h. Each x index is a row,
+ * encoded separately.
+ * Values are decoded when they are accessed. The array cannot be modified.
+ */
+
+#include <memory>
+#include <type_traits>
+#include "array2D_ax.h"
+#include "table_encoding.h"
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+class encoded_array2D
+{
+	static_assert(std::is_same<datatype, float>::value, "Encoded arrays hold single precision values.");
+
+public:
+	using x_type = typename ax_x::value_type;
+	using y_type = typename ax_y::value_type;
+	using value_type = datatype;
+	using codec_type = table_encoding::codec<encoding>;
+	using stored_type = typename codec_type::stored_type;
+
+// Constructors
+	// Encode the values of an array.
+	inline encoded_array2D(array2D_ax<datatype, ax_x, ax_y> const & source);
+	// Initialise to invalid state.
+	inline encoded_array2D() = default;
+
+	inline encoded_array2D(encoded_array2D &&) = default;
+	inline encoded_array2D& operator=(encoded_array2D &&) = default;
+
+// Element access
+	// Decoded element, unchecked bounds
+	inline value_type operator()(size_t pos_x, size_t pos_y) const;
+
+	inline x_type get_x(size_t pos_x) const;
+	inline y_type get_y(size_t pos_y) const;
+
+	// Find the index corresponding to x and y, see array2D_ax.
+	inline x_type find_x(x_type x) const;
+	inline y_type find_y(y_type y) const;
+
+	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
+	inline value_type at_linear(x_type x, y_type y) const;
+
+	// Largest absolute difference between a decoded value and the original one.
+	inline value_type get_encoding_error() const;
+
+// Capacity
+	inline size_t width() const;
+	inline size_t height() const;
+	inline size_t size() const;
+
+private:
+	using row_type = typename codec_type::row_type;
+
+	ax_x _x_axis;
+	ax_y _y_axis;
+	std::unique_ptr<stored_type[]> _data;
+	std::unique_ptr<row_type[]> _rows;
+	value_type _encoding_error = 0;
+};
+
+#include "encoded_array2D.inl"
+
+#endif
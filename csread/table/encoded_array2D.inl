@@ -0,0 +1,90 @@
+#include <algorithm>
+#include "encoded_array2D.h"
+#include "table_index.h"
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+encoded_array2D<datatype, encoding, ax_x, ax_y>::encoded_array2D(array2D_ax<datatype, ax_x, ax_y> const & source) :
+	_x_axis(source.get_x_axis()), _y_axis(source.get_y_axis()),
+	_data(new stored_type[source.size()]), _rows(new row_type[source.width()])
+{
+	for (size_t ix = 0; ix < width(); ++ix)
+	{
+		datatype const * source_row = source.data() + ix*height();
+		_rows[ix] = codec_type::make_row(source_row, height());
+		for (size_t iy = 0; iy < height(); ++iy)
+		{
+			_data[ix*height() + iy] = codec_type::encode(source_row[iy], _rows[ix]);
+			_encoding_error = std::max<value_type>(_encoding_error,
+				table_encoding::encoding_error(source_row[iy], (*this)(ix, iy)));
+		}
+	}
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::operator()(size_t pos_x, size_t pos_y) const -> value_type
+{
+	return codec_type::decode(_data[pos_x*height() + pos_y], _rows[pos_x]);
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::get_x(size_t pos_x) const -> x_type
+{
+	return _x_axis[pos_x];
+}
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::get_y(size_t pos_y) const -> y_type
+{
+	return _y_axis[pos_y];
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::find_x(x_type x) const -> x_type
+{
+	return _x_axis.find(x);
+}
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::find_y(y_type y) const -> y_type
+{
+	return _y_axis.find(y);
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::at_linear(x_type x, y_type y) const -> value_type
+{
+	const linear_index<x_type> index_x(_x_axis.find(x), _x_axis.size());
+	const linear_index<y_type> index_y(_y_axis.find(y), _y_axis.size());
+	const x_type frac_x = index_x.frac;
+	const y_type frac_y = index_y.frac;
+
+	const value_type v00 = (*this)(index_x.low, index_y.low);
+	const value_type v10 = (*this)(index_x.low + 1, index_y.low);
+	const value_type v01 = (*this)(index_x.low, index_y.low + 1);
+	const value_type v11 = (*this)(index_x.low + 1, index_y.low + 1);
+
+	return (1 - frac_x)*(1 - frac_y)*v00
+		+ frac_x*(1 - frac_y)*v10
+		+ (1 - frac_x)*frac_y*v01
+		+ frac_x*frac_y*v11;
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, encoding, ax_x, ax_y>::get_encoding_error() const -> value_type
+{
+	return _encoding_error;
+}
+
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, encoding, ax_x, ax_y>::width() const
+{
+	return _x_axis.size();
+}
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, encoding, ax_x, ax_y>::height() const
+{
+	return _y_axis.size();
+}
+template<typename datatype, typename encoding, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, encoding, ax_x, ax_y>::size() const
+{
+	return width() * height();
+}
@@ -0,0 +1,40 @@
+#ifndef __LINEAR_ROWS_H_
+#define __LINEAR_ROWS_H_
+
+/*
+ * Linear interpolation in a 2D table (array2D_ax) at the same set of y
+ * positions for many x positions, as in building a fast table row by row.
+ * Gives the same values as array2D_ax::at_linear_index, bit for bit. The y
+ * indices and weights are worked out once, so the inner loop of fill_row()
+ * has no clamps or branches.
+ */
+
+#include <cstddef>
+#include <vector>
+#include "table_index.h"
+
+template<typename table_t>
+class linear_rows
+{
+public:
+	using x_type = typename table_t::x_type;
+	using y_type = typename table_t::y_type;
+	using value_type = typename table_t::value_type;
+
+	// true_y are true indices on the y axis, see array2D_ax::find_y.
+	// The table must outlive this object.
+	inline linear_rows(table_t const & table, std::vector<y_type> const & true_y);
+
+	// Fill row[i] with the value at true_x and true_y[i], converted to out_t.
+	template<typename out_t>
+	inline void fill_row(x_type true_x, out_t* row) const;
+
+private:
+	table_t const & _table;
+	std::vector<size_t> _low_y;
+	std::vector<y_type> _frac_y;
+};
+
+#include "linear_rows.inl"
+
+#endif
@@ -0,0 +1,40 @@
+#include "linear_rows.h"
+#include "table_index.h"
+
+template<typename table_t>
+linear_rows<table_t>::linear_rows(table_t const & table, std::vector<y_type> const & true_y) :
+	_table(table)
+{
+	_low_y.reserve(true_y.size());
+	_frac_y.reserve(true_y.size());
+	for (y_type y : true_y)
+	{
+		const linear_index<y_type> index(y, table.height());
+		_low_y.push_back(index.low);
+		_frac_y.push_back(index.frac);
+	}
+}
+
+template<typename table_t>
+template<typename out_t>
+void linear_rows<table_t>::fill_row(x_type true_x, out_t* row) const
+{
+	const linear_index<x_type> index_x(true_x, _table.width());
+	const x_type frac_x = index_x.frac;
+	value_type const * row0 = _table.data() + index_x.low*_table.height();
+	value_type const * row1 = row0 + _table.height();
+
+	size_t const * low_y = _low_y.data();
+	y_type const * frac_y = _frac_y.data();
+	const size_t N = _low_y.size();
+	for (size_t i = 0; i < N; ++i)
+	{
+		// Same terms, in the same order, as array2D_ax::at_linear_index
+		const size_t j = low_y[i];
+		const y_type f = frac_y[i];
+		row[i] = static_cast<out_t>((1 - frac_x)*(1 - f)*row0[j]
+			+ frac_x*(1 - f)*row1[j]
+			+ (1 - frac_x)*f*row0[j + 1]
+			+ frac_x*f*row1[j + 1]);
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef __MATH_POLICY_H_
+#define __MATH_POLICY_H_
+
+/*
+ * Policies for the log() and exp() calls in table lookups. The policy is a
+ * template parameter of the log spaced axes; tables take it from their axis.
+ *
+ * exact_math uses the standard library.
+ *
+ * fast_math uses short polynomials for float. log() has an absolute error
+ * below 5e-7, exp() a relative error below 2e-7, both on top of rounding
+ * the result. That is far below the interpolation error of fast tables.
+ * Other types, and special arguments (not normal, positive and finite for
+ * log(); out of [-87, 88] for exp()), go to the standard library.
+ *
+ * fast_math is inlined, which pays off where calls are expensive. Recent
+ * glibc versions have fast logf() and expf() of their own, which use FMA
+ * when the CPU has it; compile with FMA enabled (e.g. -march=native) to
+ * benefit from fast_math there.
+ */
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+struct exact_math
+{
+	template<typename real_type>
+	static real_type log(real_type x)
+	{
+		return std::log(x);
+	}
+
+	template<typename real_type>
+	static real_type exp(real_type x)
+	{
+		return std::exp(x);
+	}
+};
+
+struct fast_math
+{
+	template<typename real_type>
+	static real_type log(real_type x)
+	{
+		return std::log(x);
+	}
+
+	static float log(float x)
+	{
+		if (!(x >= FLT_MIN && x <= FLT_MAX))
+			return std::log(x);
+
+		// x = m * 2^e, with m in [sqrt(1/2), sqrt(2))
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		const uint32_t offset = bits - 0x3f3504f3;
+		const float e = static_cast<float>(static_cast<int32_t>(offset) >> 23);
+		bits -= offset & 0xff800000;
+		float m;
+		std::memcpy(&m, &bits, sizeof(m));
+
+		// log(1+t) = t - t^2/2 + t^3 p(t)
+		const float t = m - 1;
+		const float t2 = t*t;
+		float p = 1.1199551473e-1f;
+		p = p*t - 1.8395984732e-1f;
+		p = p*t + 2.0587408200e-1f;
+		p = p*t - 2.4946292136e-1f;
+		p = p*t + 3.3312853041e-1f;
+
+		// log(2) = 0.693359375 - 2.12194440e-4, the first part is exact
+		return e*0.693359375f + ((t - 0.5f*t2 + t2*t*p) - e*2.12194440e-4f);
+	}
+
+	template<typename real_type>
+	static real_type exp(real_type x)
+	{
+		return std::exp(x);
+	}
+
+	static float exp(float x)
+	{
+		if (!(x >= -87.f && x <= 88.f))
+			return std::exp(x);
+
+		// x = n*log(2) + r, |r| <= log(2)/2. Adding 1.5*2^23 rounds to an
+		// integer, which ends up in the low bits of "shifted".
+		const float shifted = x*1.44269504f + 12582912.f;
+		const float n = shifted - 12582912.f;
+		const float r = (x - n*0.693359375f) + n*2.12194440e-4f;
+
+		// exp(r) = 1 + r + r^2 p(r)
+		float p = 8.3338379503e-3f;
+		p = p*r + 4.1898577938e-2f;
+		p = p*r + 1.6666886383e-1f;
+		p = p*r + 4.9999142573e-1f;
+		const float y = 1 + (r + r*r*p);
+
+		// 2^n
+		uint32_t scale_bits;
+		std::memcpy(&scale_bits, &shifted, sizeof(scale_bits));
+		scale_bits = (scale_bits - 0x4b400000 + 127) << 23;
+		float scale;
+		std::memcpy(&scale, &scale_bits, sizeof(scale));
+		return y*scale;
+	}
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __SLOPE_ARRAY1D_H_
+#define __SLOPE_ARRAY1D_H_
+
+/*
+ * encoded_array1D with the slope encoding, see table_encoding.h.
+ * Each value is stored with the difference to the next one, as interleaved
+ * (value, difference) pairs; the difference is zero for the last value and
+ * for non-finite values. at_linear() then needs one pair per lookup.
+ * The array cannot be modified.
+ */
+
+#include <memory>
+#include "array1D_ax.h"
+#include "encoded_array1D.h"
+#include "table_encoding.h"
+
+template<typename datatype, typename ax>
+class encoded_array1D<datatype, table_encoding::slope, ax>
+{
+public:
+	using x_type = typename ax::value_type;
+	using value_type = datatype;
+
+// Constructors
+	// Compute the differences of an array.
+	inline encoded_array1D(array1D_ax<datatype, ax> const & source);
+	// Initialise to invalid state.
+	inline encoded_array1D() = default;
+
+	inline encoded_array1D(encoded_array1D &&) = default;
+	inline encoded_array1D& operator=(encoded_array1D &&) = default;
+
+// Element access
+	// Element, unchecked bounds
+	inline value_type operator()(size_t pos) const;
+
+	inline x_type get_x(size_t pos) const;
+
+	// Find the index corresponding to x, see array1D_ax.
+	inline x_type find_index(x_type x) const;
+
+	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
+	inline value_type at_linear(x_type x) const;
+
+	// Values are stored as they are: always zero.
+	inline value_type get_encoding_error() const;
+
+// Capacity
+	inline size_t size() const;
+
+private:
+	ax _x_axis;
+	std::unique_ptr<datatype[]> _data;
+};
+
+#include "slope_array1D.inl"
+
+#endif
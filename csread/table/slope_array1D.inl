@@ -0,0 +1,54 @@
+#include <cmath>
+#include "slope_array1D.h"
+#include "table_index.h"
+
+template<typename datatype, typename ax>
+encoded_array1D<datatype, table_encoding::slope, ax>::encoded_array1D(array1D_ax<datatype, ax> const & source) :
+	_x_axis(source.get_x_axis()), _data(new datatype[2*source.size()])
+{
+	const size_t N = source.size();
+	for (size_t i = 0; i < N; ++i)
+	{
+		_data[2*i] = source(i);
+		_data[2*i + 1] = (i + 1 < N && std::isfinite(source(i))) ? source(i + 1) - source(i) : 0;
+	}
+}
+
+template<typename datatype, typename ax>
+auto encoded_array1D<datatype, table_encoding::slope, ax>::operator()(size_t pos) const -> value_type
+{
+	return _data[2*pos];
+}
+
+template<typename datatype, typename ax>
+auto encoded_array1D<datatype, table_encoding::slope, ax>::get_x(size_t pos) const -> x_type
+{
+	return _x_axis[pos];
+}
+
+template<typename datatype, typename ax>
+auto encoded_array1D<datatype, table_encoding::slope, ax>::find_index(x_type x) const -> x_type
+{
+	return _x_axis.find(x);
+}
+
+template<typename datatype, typename ax>
+auto encoded_array1D<datatype, table_encoding::slope, ax>::at_linear(x_type x) const -> value_type
+{
+	const linear_index<x_type> index(_x_axis.find(x), _x_axis.size());
+	datatype const * pair = _data.get() + 2*index.low;
+
+	return pair[0] + index.frac*pair[1];
+}
+
+template<typename datatype, typename ax>
+auto encoded_array1D<datatype, table_encoding::slope, ax>::get_encoding_error() const -> value_type
+{
+	return 0;
+}
+
+template<typename datatype, typename ax>
+size_t encoded_array1D<datatype, table_encoding::slope, ax>::size() const
+{
+	return _x_axis.size();
+}
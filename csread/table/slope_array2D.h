@@ -0,0 +1,65 @@
+#ifndef __SLOPE_ARRAY2D_H_
+#define __SLOPE_ARRAY2D_H_
+
+/*
+ * encoded_array2D with the slope encoding, see table_encoding.h.
+ * Each value is stored with the difference to the next one in the same row
+ * (the next y index), as interleaved (value, difference) pairs; the
+ * difference is zero for the last column and for non-finite values.
+ * at_linear() then needs one pair from each of two rows per lookup.
+ * The array cannot be modified.
+ */
+
+#include <memory>
+#include "array2D_ax.h"
+#include "encoded_array2D.h"
+#include "table_encoding.h"
+
+template<typename datatype, typename ax_x, typename ax_y>
+class encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>
+{
+public:
+	using x_type = typename ax_x::value_type;
+	using y_type = typename ax_y::value_type;
+	using value_type = datatype;
+
+// Constructors
+	// Compute the differences of an array.
+	inline encoded_array2D(array2D_ax<datatype, ax_x, ax_y> const & source);
+	// Initialise to invalid state.
+	inline encoded_array2D() = default;
+
+	inline encoded_array2D(encoded_array2D &&) = default;
+	inline encoded_array2D& operator=(encoded_array2D &&) = default;
+
+// Element access
+	// Element, unchecked bounds
+	inline value_type operator()(size_t pos_x, size_t pos_y) const;
+
+	inline x_type get_x(size_t pos_x) const;
+	inline y_type get_y(size_t pos_y) const;
+
+	// Find the index corresponding to x and y, see array2D_ax.
+	inline x_type find_x(x_type x) const;
+	inline y_type find_y(y_type y) const;
+
+	// Find a value using linear interpolation, linearly extrapolating when out of range value is requested.
+	inline value_type at_linear(x_type x, y_type y) const;
+
+	// Values are stored as they are: always zero.
+	inline value_type get_encoding_error() const;
+
+// Capacity
+	inline size_t width() const;
+	inline size_t height() const;
+	inline size_t size() const;
+
+private:
+	ax_x _x_axis;
+	ax_y _y_axis;
+	std::unique_ptr<datatype[]> _data;
+};
+
+#include "slope_array2D.inl"
+
+#endif
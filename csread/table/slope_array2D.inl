@@ -0,0 +1,88 @@
+#include <cmath>
+#include "slope_array2D.h"
+#include "table_index.h"
+
+template<typename datatype, typename ax_x, typename ax_y>
+encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::encoded_array2D(array2D_ax<datatype, ax_x, ax_y> const & source) :
+	_x_axis(source.get_x_axis()), _y_axis(source.get_y_axis()),
+	_data(new datatype[2*source.size()])
+{
+	for (size_t ix = 0; ix < width(); ++ix)
+	{
+		datatype const * source_row = source.data() + ix*height();
+		datatype* row = _data.get() + 2*ix*height();
+		for (size_t iy = 0; iy < height(); ++iy)
+		{
+			row[2*iy] = source_row[iy];
+			row[2*iy + 1] = (iy + 1 < height() && std::isfinite(source_row[iy]))
+				? source_row[iy + 1] - source_row[iy] : 0;
+		}
+	}
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::operator()(size_t pos_x, size_t pos_y) const -> value_type
+{
+	return _data[2*(pos_x*height() + pos_y)];
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::get_x(size_t pos_x) const -> x_type
+{
+	return _x_axis[pos_x];
+}
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::get_y(size_t pos_y) const -> y_type
+{
+	return _y_axis[pos_y];
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::find_x(x_type x) const -> x_type
+{
+	return _x_axis.find(x);
+}
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::find_y(y_type y) const -> y_type
+{
+	return _y_axis.find(y);
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::at_linear(x_type x, y_type y) const -> value_type
+{
+	const linear_index<x_type> index_x(_x_axis.find(x), _x_axis.size());
+	const linear_index<y_type> index_y(_y_axis.find(y), _y_axis.size());
+	const x_type frac_x = index_x.frac;
+	const y_type frac_y = index_y.frac;
+
+	// Interpolate along y in both rows, then along x
+	datatype const * pair0 = _data.get() + 2*(index_x.low*height() + index_y.low);
+	datatype const * pair1 = pair0 + 2*height();
+	const value_type v0 = pair0[0] + frac_y*pair0[1];
+	const value_type v1 = pair1[0] + frac_y*pair1[1];
+
+	return v0 + frac_x*(v1 - v0);
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+auto encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::get_encoding_error() const -> value_type
+{
+	return 0;
+}
+
+template<typename datatype, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::width() const
+{
+	return _x_axis.size();
+}
+template<typename datatype, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::height() const
+{
+	return _y_axis.size();
+}
+template<typename datatype, typename ax_x, typename ax_y>
+size_t encoded_array2D<datatype, table_encoding::slope, ax_x, ax_y>::size() const
+{
+	return width() * height();
+}
@@ -0,0 +1,204 @@
+#ifndef __TABLE_ENCODING_H_
+#define __TABLE_ENCODING_H_
+
+/*
+ * Compact storage formats for table values, see encoded_array1D and encoded_array2D.
+ *
+ * Each encoding is a tag type, with a codec that converts single precision
+ * values to and from the stored type. Values are encoded one row at a time,
+ * so that an encoding may keep parameters per row (q16). For 1D tables, the
+ * whole table is one row.
+ *
+ * All 16-bit encodings halve the memory of a float table.
+ *  - fp16: IEEE 754 half precision. 11 significant bits, range up to 65504,
+ *    infinities are kept. Suited for log(IMFP).
+ *  - bf16: bfloat16, the upper half of a float. 8 significant bits, but the
+ *    full float range.
+ *  - q16:  unsigned 16-bit fixed point, scaled and offset per row to span the
+ *    finite values of that row. Suited for bounded values such as ICDFs.
+ *    Non-finite values cannot be represented.
+ *
+ * Rounding is to nearest, ties to even. The conversions are portable bit
+ * manipulation, no special instructions are needed.
+ *
+ * slope is not compact, and has no codec: each value is stored together with
+ * the difference to the next one, as (value, difference) pairs. This doubles
+ * the memory, but linear interpolation takes one load and one multiply-add
+ * per dimension. See slope_array1D.h and slope_array2D.h.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace table_encoding
+{
+	struct native {}; // Values stored as they are
+	struct fp16 {};
+	struct bf16 {};
+	struct q16 {};
+	struct slope {};
+
+	template<typename encoding>
+	struct codec;
+
+	template<>
+	struct codec<fp16>
+	{
+		using stored_type = uint16_t;
+		struct row_type {};
+
+		static row_type make_row(float const *, size_t)
+		{
+			return{};
+		}
+
+		static stored_type encode(float value, row_type const &)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			const uint32_t sign = bits & 0x80000000u;
+			bits ^= sign;
+
+			uint32_t result;
+			if (bits >= (127u + 16) << 23)
+			{
+				// Too large: infinity. Or infinity or NaN to begin with.
+				result = (bits > 255u << 23) ? 0x7e00 : 0x7c00;
+			}
+			else if (bits < 113u << 23)
+			{
+				// Subnormal or zero: let the FPU align and round the mantissa.
+				const uint32_t magic_bits = ((127u - 15) + (23 - 10) + 1) << 23;
+				float magic, f;
+				std::memcpy(&magic, &magic_bits, sizeof(magic));
+				std::memcpy(&f, &bits, sizeof(f));
+				f += magic;
+				std::memcpy(&result, &f, sizeof(result));
+				result -= magic_bits;
+			}
+			else
+			{
+				// Normal: adjust the exponent and round the mantissa.
+				const uint32_t mantissa_odd = (bits >> 13) & 1;
+				bits += ((15u - 127) << 23) + 0xfff + mantissa_odd;
+				result = bits >> 13;
+			}
+			return static_cast<stored_type>(result | (sign >> 16));
+		}
+
+		static float decode(stored_type stored, row_type const &)
+		{
+			const uint32_t shifted_exponent = 0x7c00u << 13;
+			uint32_t bits = (stored & 0x7fffu) << 13;
+			const uint32_t exponent = bits & shifted_exponent;
+			bits += (127u - 15) << 23;
+
+			float result;
+			if (exponent == shifted_exponent)
+			{
+				// Infinity or NaN
+				bits += (128u - 16) << 23;
+				std::memcpy(&result, &bits, sizeof(result));
+			}
+			else if (exponent == 0)
+			{
+				// Subnormal or zero: renormalise
+				const uint32_t magic_bits = 113u << 23;
+				float magic;
+				std::memcpy(&magic, &magic_bits, sizeof(magic));
+				bits += 1u << 23;
+				std::memcpy(&result, &bits, sizeof(result));
+				result -= magic;
+			}
+			else
+			{
+				std::memcpy(&result, &bits, sizeof(result));
+			}
+			return (stored & 0x8000u) ? -result : result;
+		}
+	};
+
+	template<>
+	struct codec<bf16>
+	{
+		using stored_type = uint16_t;
+		struct row_type {};
+
+		static row_type make_row(float const *, size_t)
+		{
+			return{};
+		}
+
+		static stored_type encode(float value, row_type const &)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			if ((bits & 0x7fffffffu) > 0x7f800000u)
+				return static_cast<stored_type>((bits >> 16) | 0x40); // Keep NaN a (quiet) NaN
+			bits += 0x7fff + ((bits >> 16) & 1);
+			return static_cast<stored_type>(bits >> 16);
+		}
+
+		static float decode(stored_type stored, row_type const &)
+		{
+			const uint32_t bits = static_cast<uint32_t>(stored) << 16;
+			float result;
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
+	};
+
+	template<>
+	struct codec<q16>
+	{
+		using stored_type = uint16_t;
+		struct row_type
+		{
+			float offset;
+			float scale;
+		};
+
+		static row_type make_row(float const * values, size_t count)
+		{
+			float low = INFINITY;
+			float high = -INFINITY;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (std::isfinite(values[i]))
+				{
+					low = std::min(low, values[i]);
+					high = std::max(high, values[i]);
+				}
+			}
+			if (!(low <= high))
+				return{ 0, 0 };
+			return{ low, (high - low) / 65535 };
+		}
+
+		static stored_type encode(float value, row_type const & row)
+		{
+			if (!(row.scale > 0))
+				return 0;
+			const float scaled = std::nearbyint((value - row.offset) / row.scale);
+			return static_cast<stored_type>(std::max(0.f, std::min(scaled, 65535.f)));
+		}
+
+		static float decode(stored_type stored, row_type const & row)
+		{
+			return row.offset + row.scale*stored;
+		}
+	};
+
+	// Difference between a value and its encoded version. Not-a-number counts as infinite.
+	inline float encoding_error(float value, float decoded)
+	{
+		if (value == decoded)
+			return 0; // Also for infinities
+		const float error = std::abs(decoded - value);
+		return std::isnan(error) ? INFINITY : error;
+	}
+}
+
+#endif
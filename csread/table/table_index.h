@@ -0,0 +1,36 @@
+#ifndef __TABLE_INDEX_H_
+#define __TABLE_INDEX_H_
+
+/*
+ * Index computations shared by the lookups in all table types.
+ * true_index is a position on an axis, as returned by the axis' find()
+ * function, and size is the number of points on that axis.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include "../clamp.h"
+
+// Grid point below true_index, and the fraction of the way to the next one.
+// The grid point is clamped such that the next one exists, so the fraction
+// extrapolates linearly outside the axis.
+template<typename real_type>
+struct linear_index
+{
+	size_t low;
+	real_type frac;
+
+	linear_index(real_type true_index, size_t size) :
+		low(static_cast<size_t>(_clamp<real_type>(true_index, 0, static_cast<real_type>(size - 2)))),
+		frac(true_index - low)
+	{}
+};
+
+// Grid point at or below true_index, clamped to the axis.
+template<typename real_type>
+size_t rounddown_index(real_type true_index, size_t size)
+{
+	return static_cast<size_t>(_clamp<real_type>(true_index, 0, static_cast<real_type>(size - 1)));
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "table_cache.h"
+
+/*
+ * Cache file layout:
+ *   char[8]  magic, "csrdtbl" + '\0'
+ *   uint32   file format version
+ *   key_t    copy of the key, guards against hash collisions
+ *   uint64   checksum of the values (FNV-1a)
+ *   values   key.value_size * key.N_K * key.N_P bytes
+ */
+
+namespace
+{
+	const char cache_magic[8] = "csrdtbl";
+	// 2: built on division-free axes, see table/ax_linspace.h
+	// 3: exact probability axis points, see table/ax_unit_interval.h
+	const uint32_t cache_version = 3;
+	const uint64_t fnv_prime = 1099511628211ULL;
+
+	// Add a plain value to a running hash.
+	template<typename T>
+	uint64_t hash_value(uint64_t hash, T const & value)
+	{
+		return table_cache::hash_bytes(&value, sizeof(value), hash);
+	}
+}
+
+constexpr uint64_t table_cache::fnv_offset;
+
+table_cache::table_cache(std::string const & directory) :
+	directory(directory)
+{}
+
+bool table_cache::load(key_t const & key, void* data, size_t count) const
+{
+	if (count != key.N_K * key.N_P)
+		return false;
+
+	std::ifstream file(get_filename(key), std::ios::binary);
+	if (!file)
+		return false;
+
+	char magic[8];
+	uint32_t version;
+	key_t file_key;
+	uint64_t checksum;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&file_key), sizeof(file_key));
+	file.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+	if (!file
+		|| std::memcmp(magic, cache_magic, sizeof(magic)) != 0
+		|| version != cache_version
+		|| !keys_equal(key, file_key))
+	{
+		return false;
+	}
+
+	const size_t size_bytes = count * key.value_size;
+	file.read(static_cast<char*>(data), size_bytes);
+	if (!file || file.gcount() != static_cast<std::streamsize>(size_bytes))
+		return false;
+
+	return hash_bytes(data, size_bytes) == checksum;
+}
+
+void table_cache::store(key_t const & key, void const * data, size_t count) const
+{
+	if (count != key.N_K * key.N_P)
+		return;
+
+	// Write to a temporary file first and rename it afterwards, so that other
+	// processes never see a partially written cache file.
+	const std::string filename = get_filename(key);
+	const std::string temp_filename = filename + ".tmp" + std::to_string(std::random_device()());
+
+	const size_t size_bytes = count * key.value_size;
+	const uint64_t checksum = hash_bytes(data, size_bytes);
+	{
+		std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return;
+		file.write(cache_magic, sizeof(cache_magic));
+		file.write(reinterpret_cast<char const *>(&cache_version), sizeof(cache_version));
+		file.write(reinterpret_cast<char const *>(&key), sizeof(key));
+		file.write(reinterpret_cast<char const *>(&checksum), sizeof(checksum));
+		file.write(static_cast<char const *>(data), size_bytes);
+		if (!file)
+		{
+			file.close();
+			std::remove(temp_filename.c_str());
+			return;
+		}
+	}
+
+	if (std::rename(temp_filename.c_str(), filename.c_str()) != 0)
+		std::remove(temp_filename.c_str());
+}
+
+std::string const & table_cache::get_directory() const
+{
+	return directory;
+}
+
+uint64_t table_cache::hash_file(std::string const & filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("Could not open " + filename + " for hashing.");
+
+	uint64_t hash = fnv_offset;
+	std::vector<char> buffer(1 << 16);
+	while (file)
+	{
+		file.read(buffer.data(), buffer.size());
+		hash = hash_bytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+	}
+	if (!file.eof())
+		throw std::runtime_error("Error reading " + filename + " for hashing.");
+
+	return hash;
+}
+
+uint64_t table_cache::hash_bytes(void const * data, size_t size, uint64_t seed)
+{
+	unsigned char const * bytes = static_cast<unsigned char const *>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= fnv_prime;
+	}
+	return hash;
+}
+
+uint64_t table_cache::hash_key(key_t const & key)
+{
+	uint64_t hash = fnv_offset;
+	hash = hash_value(hash, key.source_hash);
+	hash = hash_value(hash, key.kind);
+	hash = hash_value(hash, key.value_size);
+	hash = hash_value(hash, key.K_min);
+	hash = hash_value(hash, key.K_max);
+	hash = hash_value(hash, key.N_K);
+	hash = hash_value(hash, key.N_P);
+	return hash;
+}
+
+bool table_cache::keys_equal(key_t const & a, key_t const & b)
+{
+	return a.source_hash == b.source_hash
+		&& a.kind == b.kind
+		&& a.value_size == b.value_size
+		&& a.K_min == b.K_min
+		&& a.K_max == b.K_max
+		&& a.N_K == b.N_K
+		&& a.N_P == b.N_P;
+}
+
+std::string table_cache::get_filename(key_t const & key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.tbl", static_cast<unsigned long long>(hash_key(key)));
+	return directory + "/" + name;
+}
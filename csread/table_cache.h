@@ -0,0 +1,66 @@
+#ifndef __TABLE_CACHE_H_
+#define __TABLE_CACHE_H_
+
+/*
+ * Persistent on-disk cache for the fast tables built by the material class.
+ *
+ * Building a fast table from the intern tables is relatively expensive, while
+ * the inputs hardly ever change between runs. This class stores the resulting
+ * values in a directory, one file per table. The file name is a hash of the
+ * source file contents, the kind of table and the grid parameters. Only the
+ * values are stored: the axes follow directly from the grid parameters.
+ *
+ * The cache is an optimisation only. A missing, stale or corrupt cache file is
+ * treated as a miss, and failure to write a cache file is silently ignored.
+ * Files are written in native byte order, the cache is not meant to be shared
+ * between machines of different architecture.
+ */
+
+#include <cstdint>
+#include <string>
+
+class table_cache
+{
+public:
+	// Identifies a single table.
+	struct key_t
+	{
+		uint64_t source_hash; // Hash of the source (HDF5) file contents
+		uint32_t kind;        // Which table, e.g. elastic IMFP
+		uint32_t value_size;  // sizeof(value type)
+		double K_min;
+		double K_max;
+		uint64_t N_K;
+		uint64_t N_P;         // 1 for one-dimensional tables
+	};
+
+	// Use the given directory, which must exist.
+	table_cache(std::string const & directory);
+
+	// Load "count" values into "data".
+	// Returns false, leaving data in an unspecified state, if there is no valid cache entry.
+	bool load(key_t const & key, void* data, size_t count) const;
+
+	// Store "count" values. Failures are ignored.
+	void store(key_t const & key, void const * data, size_t count) const;
+
+	std::string const & get_directory() const;
+
+	// Hash of all fields in a key, and comparison.
+	static uint64_t hash_key(key_t const & key);
+	static bool keys_equal(key_t const & a, key_t const & b);
+
+	// 64-bit FNV-1a hash of a file's contents, or of a buffer.
+	// May throw std::runtime_error exceptions if the file cannot be read.
+	static uint64_t hash_file(std::string const & filename);
+	static uint64_t hash_bytes(void const * data, size_t size, uint64_t seed = fnv_offset);
+
+private:
+	static constexpr uint64_t fnv_offset = 14695981039346656037ULL;
+
+	std::string directory;
+
+	std::string get_filename(key_t const & key) const;
+};
+
+#endif
@@ -38,16 +38,30 @@ struct dimension
 		return *this;
 	}
 
-	const dimension operator*(dimension const & rhs) const
+	constexpr dimension operator*(dimension const & rhs) const
 	{
-		return dimension(*this) *= rhs;
+		return dimension
+		{
+			energy + rhs.energy,
+			length + rhs.length,
+			time + rhs.time,
+			temperature + rhs.temperature,
+			charge + rhs.charge
+		};
 	}
-	const dimension operator/(dimension const & rhs) const
+	constexpr dimension operator/(dimension const & rhs) const
 	{
-		return dimension(*this) /= rhs;
+		return dimension
+		{
+			energy - rhs.energy,
+			length - rhs.length,
+			time - rhs.time,
+			temperature - rhs.temperature,
+			charge - rhs.charge
+		};
 	}
 
-	bool operator==(dimension const & rhs) const
+	constexpr bool operator==(dimension const & rhs) const
 	{
 		return energy == rhs.energy
 			&& length == rhs.length
@@ -55,13 +69,13 @@ struct dimension
 			&& temperature == rhs.temperature
 			&& charge == rhs.charge;
 	}
-	bool operator!=(dimension const & rhs) const
+	constexpr bool operator!=(dimension const & rhs) const
 	{
 		return !(*this == rhs);
 	}
 };
 
-inline dimension pow(dimension dim, int power)
+constexpr dimension pow(dimension dim, int power)
 {
 	return dimension
 	{
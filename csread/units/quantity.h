@@ -7,6 +7,7 @@
 
 #include "dimension.h"
 #include <cmath>
+#include <stdexcept>
 
 template<typename T>
 struct quantity
@@ -0,0 +1,185 @@
+#ifndef __STATIC_QUANTITY_H_
+#define __STATIC_QUANTITY_H_
+
+/*
+ * A static_quantity is a number with a dimension that is known at compile time.
+ *
+ * Unlike quantity<T>, the dimension is a template parameter. Adding quantities
+ * of different dimension fails to compile, and there is no dimension stored or
+ * checked at runtime: a static_quantity<T, ...> is just a T.
+ *
+ * Use quantity_cast to convert from a quantity<T> (e.g. parsed from a file),
+ * which checks the dimension once. A static_quantity converts implicitly to a
+ * quantity<T>.
+ *
+ * The bottom of this file defines the standard dimensions as types.
+ */
+
+#include <stdexcept>
+#include "dimension.h"
+#include "quantity.h"
+
+template<int energy, int length, int time, int temperature, int charge>
+struct static_dimension
+{
+	static constexpr dimension value{ energy, length, time, temperature, charge };
+
+	using inverse = static_dimension<-energy, -length, -time, -temperature, -charge>;
+
+	template<typename rhs>
+	using multiply = static_dimension<
+		energy + rhs::energy_power,
+		length + rhs::length_power,
+		time + rhs::time_power,
+		temperature + rhs::temperature_power,
+		charge + rhs::charge_power>;
+
+	template<typename rhs>
+	using divide = multiply<typename rhs::inverse>;
+
+	static constexpr int energy_power = energy;
+	static constexpr int length_power = length;
+	static constexpr int time_power = time;
+	static constexpr int temperature_power = temperature;
+	static constexpr int charge_power = charge;
+};
+
+template<int energy, int length, int time, int temperature, int charge>
+constexpr dimension static_dimension<energy, length, time, temperature, charge>::value;
+
+template<typename T, typename dim>
+struct static_quantity
+{
+	using value_type = T;
+	using dimension_type = dim;
+
+	value_type value;
+
+	static_quantity& operator+=(static_quantity const & rhs)
+	{
+		value += rhs.value;
+		return *this;
+	}
+	static_quantity& operator-=(static_quantity const & rhs)
+	{
+		value -= rhs.value;
+		return *this;
+	}
+	static_quantity& operator*=(value_type const rhs)
+	{
+		value *= rhs;
+		return *this;
+	}
+	static_quantity& operator/=(value_type const rhs)
+	{
+		value /= rhs;
+		return *this;
+	}
+
+	constexpr static_quantity operator+(static_quantity const & rhs) const
+	{
+		return{ value + rhs.value };
+	}
+	constexpr static_quantity operator-(static_quantity const & rhs) const
+	{
+		return{ value - rhs.value };
+	}
+	constexpr static_quantity operator-() const
+	{
+		return{ -value };
+	}
+	template<typename rhs_dim>
+	constexpr static_quantity<T, typename dim::template multiply<rhs_dim>>
+		operator*(static_quantity<T, rhs_dim> const & rhs) const
+	{
+		return{ value * rhs.value };
+	}
+	template<typename rhs_dim>
+	constexpr static_quantity<T, typename dim::template divide<rhs_dim>>
+		operator/(static_quantity<T, rhs_dim> const & rhs) const
+	{
+		return{ value / rhs.value };
+	}
+	constexpr static_quantity operator*(value_type const rhs) const
+	{
+		return{ value * rhs };
+	}
+	constexpr static_quantity operator/(value_type const rhs) const
+	{
+		return{ value / rhs };
+	}
+
+	constexpr bool operator==(static_quantity const & rhs) const
+	{
+		return value == rhs.value;
+	}
+	constexpr bool operator!=(static_quantity const & rhs) const
+	{
+		return value != rhs.value;
+	}
+	constexpr bool operator<(static_quantity const & rhs) const
+	{
+		return value < rhs.value;
+	}
+	constexpr bool operator>(static_quantity const & rhs) const
+	{
+		return value > rhs.value;
+	}
+	constexpr bool operator<=(static_quantity const & rhs) const
+	{
+		return value <= rhs.value;
+	}
+	constexpr bool operator>=(static_quantity const & rhs) const
+	{
+		return value >= rhs.value;
+	}
+
+	// Convert to a quantity with runtime dimension
+	constexpr operator quantity<T>() const
+	{
+		return{ value, dim::value };
+	}
+};
+
+template<typename T, typename dim>
+constexpr static_quantity<T, dim> operator*(T const v, static_quantity<T, dim> const & q)
+{
+	return q * v;
+}
+template<typename T, typename dim>
+constexpr static_quantity<T, typename dim::inverse> operator/(T const v, static_quantity<T, dim> const & q)
+{
+	return{ v / q.value };
+}
+
+// Convert a quantity with runtime dimension to a static_quantity.
+// Throws std::runtime_error if the dimensions do not match.
+template<typename static_quantity_type>
+static_quantity_type quantity_cast(quantity<typename static_quantity_type::value_type> const & q)
+{
+	if (q.units != static_quantity_type::dimension_type::value)
+		throw std::runtime_error("Casting quantity to incompatible units.");
+	return{ q.value };
+}
+
+namespace static_dimensions
+{
+	// Fundamental dimensions
+	using dimensionless = static_dimension<0, 0, 0, 0, 0>;
+	using energy        = static_dimension<1, 0, 0, 0, 0>;
+	using length        = static_dimension<0, 1, 0, 0, 0>;
+	using time          = static_dimension<0, 0, 1, 0, 0>;
+	using temperature   = static_dimension<0, 0, 0, 1, 0>;
+	using charge        = static_dimension<0, 0, 0, 0, 1>;
+
+	// Derived dimensions
+	using mass          = static_dimension<1, -2, 2, 0, 0>;
+	using acceleration  = static_dimension<0, 1, -2, 0, 0>;
+	using force         = static_dimension<1, -1, 0, 0, 0>;
+	using area          = static_dimension<0, 2, 0, 0, 0>;
+	using volume        = static_dimension<0, 3, 0, 0, 0>;
+	using n_density     = static_dimension<0, -3, 0, 0, 0>; // Number density
+	using m_density     = static_dimension<1, -5, 2, 0, 0>; // Mass density
+}
+
+#endif
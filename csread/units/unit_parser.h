@@ -10,6 +10,7 @@
 
 #include <string>
 #include <map>
+#include <mutex>
 #include <cctype>
 #include "unit_system.h"
 
@@ -49,6 +50,26 @@ public:
 		return value * parse_unit(text.cbegin() + next_idx, text.cend());
 	}
 
+	// Parse a unit using a shared parser holding the default units.
+	// That parser is only built once, and results are memoized. Thread-safe.
+	static quantity<double> parse_default_unit(std::string const & text)
+	{
+		static const unit_parser default_parser = []()
+		{
+			unit_parser parser;
+			parser.add_default_units();
+			return parser;
+		}();
+		static std::map<std::string, quantity<double>> memo;
+		static std::mutex memo_mutex;
+
+		std::lock_guard<std::mutex> lock(memo_mutex);
+		auto memo_iterator = memo.find(text);
+		if (memo_iterator == memo.end())
+			memo_iterator = memo.insert({ text, default_parser.parse_unit(text) }).first;
+		return memo_iterator->second;
+	}
+
 private:
 	std::map<std::string, quantity<double>> unit_map;
 
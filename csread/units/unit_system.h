@@ -8,6 +8,7 @@
  */
 
 #include "quantity.h"
+#include "static_quantity.h"
 
 namespace units
 {
@@ -28,4 +29,24 @@ namespace units
 	constexpr quantity<double> g  { 6.2415e15, dimensions::mass };   // gram
 }
 
+// Same units, with dimensions checked at compile time. See static_quantity.h.
+namespace static_units
+{
+	// Base units
+	constexpr static_quantity<double, static_dimensions::dimensionless> dimensionless{ 1 };
+	constexpr static_quantity<double, static_dimensions::energy> eV{ 1 };      // electronvolts
+	constexpr static_quantity<double, static_dimensions::length> nm{ 1 };      // nanometers
+	constexpr static_quantity<double, static_dimensions::time> ns{ 1 };        // nanoseconds
+	constexpr static_quantity<double, static_dimensions::temperature> K{ 1 };  // Kelvin
+	constexpr static_quantity<double, static_dimensions::charge> e{ 1 };       // electron charge
+
+
+	// Auxiliary units
+	constexpr static_quantity<double, static_dimensions::time> s{ 1e9 };           // second
+	constexpr static_quantity<double, static_dimensions::length> m{ 1e9 };         // meter
+	constexpr static_quantity<double, static_dimensions::length> cm{ 1e7 };        // centimeter
+	constexpr static_quantity<double, static_dimensions::charge> Clb{ 6.2415e18 }; // Coulomb
+	constexpr static_quantity<double, static_dimensions::mass> g{ 6.2415e15 };     // gram
+}
+
 #endif
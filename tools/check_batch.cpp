@@ -0,0 +1,271 @@
+/*
+ * Check the vectorized get_batch() of the fast tables (csread/simd/batch.h)
+ * against get(), on generated tables, for each instruction set supported by
+ * the CPU and this build. The scalar kernels must match get() exactly; the
+ * others within the bounds given in batch.h. The same vectors hold ordinary
+ * inputs, energies outside the tables, and NaN, infinite, zero, negative and
+ * denormal inputs, which must match exactly.
+ *
+ * Usage: csread_check_batch
+ *
+ * Prints the largest difference relative to its bound per table and
+ * instruction set, and returns 1 if a bound is exceeded.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "../csread/icdf_table.h"
+#include "../csread/imfp_table.h"
+#include "../csread/ionization_table.h"
+#include "../csread/simd/batch.h"
+
+namespace
+{
+	using energy_axis = ax_logspace<float>;
+	using probability_axis = ax_unit_interval<float>;
+
+	const float K_min = 1;
+	const float K_max = 50000;
+	const size_t N_K = 300;
+	const size_t N_P = 129;
+	const double ulp = std::ldexp(1., -23);
+
+	// Deterministic pseudo-random numbers in [0, 1)
+	struct lcg
+	{
+		uint64_t state = 12345;
+		float operator()()
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			return static_cast<float>((state >> 40) * (1.0 / 16777216.0));
+		}
+	};
+
+	bool same(float a, float b)
+	{
+		return std::memcmp(&a, &b, sizeof(float)) == 0 || (std::isnan(a) && std::isnan(b));
+	}
+
+	// Grid point below true_index and the weight of the next, as in the tables
+	struct cell_t
+	{
+		size_t low;
+		double frac;
+	};
+	cell_t cell(float true_index, size_t size)
+	{
+		const linear_index<float> index(true_index, size);
+		return{ index.low, index.frac };
+	}
+
+	// Inputs. The first samples are the special cases, energies outside the
+	// table come next, then ordinary samples.
+	void make_inputs(std::vector<float> & K, std::vector<float> & P)
+	{
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float inf = std::numeric_limits<float>::infinity();
+		const float specials_K[] = { nan, inf, -inf, 0, -0.f, -1, 1e-40f, FLT_MIN, FLT_MAX, 100, 100, 100, 100, 100 };
+		const float specials_P[] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, 0.5f, nan, inf, -inf, 1e-40f, 1e30f };
+		K.assign(std::begin(specials_K), std::end(specials_K));
+		P.assign(std::begin(specials_P), std::end(specials_P));
+
+		lcg random;
+		const float log_low = std::log(K_min / 10);
+		const float log_high = std::log(K_max * 10);
+		for (size_t i = 0; i < 4000; ++i)
+		{
+			K.push_back(std::exp(log_low + (log_high - log_low) * random()));
+			P.push_back(-0.2f + 1.4f * random());
+		}
+	}
+	const size_t N_special = 14;
+
+	struct result_t
+	{
+		double worst = 0; // Largest difference over its bound
+		bool ok = true;
+	};
+
+	void report(char const * table, char const * isa, result_t const & result)
+	{
+		std::cout << table << ", " << isa << ": largest difference " << result.worst << " of the bound\n";
+		if (!result.ok)
+			std::cerr << table << ", " << isa << ": get_batch() differs from get() beyond the bound\n";
+	}
+
+	// Compare, where differences are allowed, out[i] to expected[i] within bound(i).
+	template<typename bound_func>
+	result_t compare(std::vector<float> const & expected, std::vector<float> const & out, bool exact, bound_func bound)
+	{
+		result_t result;
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			if (same(expected[i], out[i]))
+				continue;
+			if (exact || i < N_special)
+			{
+				result.ok = false;
+				result.worst = std::numeric_limits<double>::infinity();
+				continue;
+			}
+			const double excess = std::fabs(static_cast<double>(out[i]) - expected[i]) / bound(i);
+			result.worst = std::max(result.worst, excess);
+			if (!(excess <= 1))
+				result.ok = false;
+		}
+		return result;
+	}
+
+	result_t check_imfp(std::vector<float> const & K, bool exact)
+	{
+		// A smooth log(imfp) with some structure
+		const energy_axis K_axis(K_min, K_max, N_K);
+		std::vector<float> log_imfp(N_K);
+		for (size_t i = 0; i < N_K; ++i)
+		{
+			const double log_K = std::log(K_axis[i]);
+			log_imfp[i] = static_cast<float>(-3 + 0.5*log_K + std::sin(log_K));
+		}
+		const imfp_table<float> table(array1D_ax<float, energy_axis>(K_axis, log_imfp));
+
+		std::vector<float> expected(K.size()), out(K.size());
+		for (size_t i = 0; i < K.size(); ++i)
+			expected[i] = table.get(K[i]);
+		table.get_batch(K.data(), out.data(), K.size());
+
+		return compare(expected, out, exact, [&](size_t i)
+		{
+			const float log_K = std::log(K[i]);
+			const cell_t c = cell(K_axis.find(K[i]), N_K);
+			const double v_low = table(c.low);
+			const double v_high = table(c.low + 1);
+			const double slope = (v_high - v_low) * K_axis.log_inv_step();
+			const double round_off = std::max(std::fabs((1 - c.frac) * v_low), std::fabs(c.frac * v_high));
+			return (2 + std::fabs(log_K * slope) + 2 * round_off) * ulp * expected[i];
+		});
+	}
+
+	result_t check_icdf(std::vector<float> const & K, std::vector<float> const & P, bool exact)
+	{
+		// Smooth in both directions, like an angular distribution
+		const energy_axis K_axis(K_min, K_max, N_K);
+		const probability_axis P_axis(N_P);
+		std::vector<float> values(N_K * N_P);
+		for (size_t i = 0; i < N_K; ++i)
+		{
+			const double log_K = std::log(K_axis[i]);
+			for (size_t j = 0; j < N_P; ++j)
+				values[i*N_P + j] = static_cast<float>(3.1 * std::pow(P_axis[j], 1 + 0.2*log_K));
+		}
+		const icdf_table<float> table(array2D_ax<float, energy_axis, probability_axis>(K_axis, P_axis, values));
+
+		std::vector<float> expected(K.size()), out(K.size());
+		for (size_t i = 0; i < K.size(); ++i)
+			expected[i] = table.get(K[i], P[i]);
+		table.get_batch(K.data(), P.data(), out.data(), K.size());
+
+		return compare(expected, out, exact, [&](size_t i)
+		{
+			const float log_K = std::log(K[i]);
+			const cell_t x = cell(K_axis.find(K[i]), N_K);
+			const cell_t y = cell(P_axis.find(P[i]), N_P);
+			const double v00 = table(x.low, y.low), v01 = table(x.low, y.low + 1);
+			const double v10 = table(x.low + 1, y.low), v11 = table(x.low + 1, y.low + 1);
+			const double slope = ((1 - y.frac)*(v10 - v00) + y.frac*(v11 - v01)) * K_axis.log_inv_step();
+			const double round_off = std::max({
+				std::fabs((1 - x.frac)*(1 - y.frac)*v00), std::fabs(x.frac*(1 - y.frac)*v10),
+				std::fabs((1 - x.frac)*y.frac*v01), std::fabs(x.frac*y.frac*v11) });
+			return (std::fabs(log_K * slope) + 4 * round_off + 3 * std::fabs(expected[i])) * ulp;
+		});
+	}
+
+	result_t check_ionization(std::vector<float> const & K, std::vector<float> const & P, bool exact)
+	{
+		// Binding energies: a few shells, -1 where a shell is not reached
+		const energy_axis K_axis(K_min, K_max, N_K);
+		const probability_axis P_axis(N_P);
+		std::vector<float> values(N_K * N_P);
+		for (size_t i = 0; i < N_K; ++i)
+		{
+			const float K_i = K_axis[i];
+			for (size_t j = 0; j < N_P; ++j)
+			{
+				const float shell = (j < N_P / 4 ? 1840.f : j < N_P / 2 ? 150.f : j < 3 * N_P / 4 ? 99.f : -1.f);
+				values[i*N_P + j] = (shell < K_i ? shell : -1.f);
+			}
+		}
+		const ionization_table<float> table(array2D_ax<float, energy_axis, probability_axis>(K_axis, P_axis, values));
+
+		std::vector<float> expected(K.size()), out(K.size());
+		for (size_t i = 0; i < K.size(); ++i)
+			expected[i] = table.get(K[i], P[i]);
+		table.get_batch(K.data(), P.data(), out.data(), K.size());
+
+		// Exact, unless a 1 ULP difference in log(K) moves K into the next
+		// row. Any difference is then the difference between two rows.
+		result_t result;
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			if (same(expected[i], out[i]))
+				continue;
+			bool neighbour = false;
+			if (!exact && i >= N_special)
+			{
+				const float log_K = std::log(K[i]);
+				for (float shifted : { std::nextafter(log_K, -FLT_MAX), std::nextafter(log_K, FLT_MAX) })
+				{
+					const float true_x = (shifted - K_axis.log_low()) * K_axis.log_inv_step();
+					const float true_y = P_axis.find(P[i]);
+					const float value = (true_x < 0 || true_y < 0) ? -1
+						: table(rounddown_index(true_x, N_K), rounddown_index(true_y, N_P));
+					neighbour |= same(value, out[i]);
+				}
+			}
+			if (!neighbour)
+			{
+				result.ok = false;
+				result.worst = std::numeric_limits<double>::infinity();
+			}
+		}
+		return result;
+	}
+}
+
+int main()
+{
+	std::vector<float> K, P;
+	make_inputs(K, P);
+
+	bool ok = true;
+	const struct { simd_isa_t isa; char const * name; } isas[] =
+		{ { SIMD_SCALAR, "scalar" }, { SIMD_AVX2, "AVX2" }, { SIMD_AVX512, "AVX-512" } };
+	for (auto const & isa : isas)
+	{
+		try
+		{
+			simd_batch_force_isa(isa.isa);
+		}
+		catch (std::runtime_error const &)
+		{
+			std::cout << isa.name << ": not supported, skipped\n";
+			continue;
+		}
+		const bool exact = (isa.isa == SIMD_SCALAR);
+
+		const result_t imfp = check_imfp(K, exact);
+		const result_t icdf = check_icdf(K, P, exact);
+		const result_t ionization = check_ionization(K, P, exact);
+		report("imfp_table", isa.name, imfp);
+		report("icdf_table", isa.name, icdf);
+		report("ionization_table", isa.name, ionization);
+		ok &= imfp.ok && icdf.ok && ionization.ok;
+	}
+	return ok ? 0 : 1;
+}
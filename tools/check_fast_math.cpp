@@ -0,0 +1,121 @@
+/*
+ * Check the error bounds of fast_math (csread/table/math_policy.h) for all
+ * normal floats, against the standard library in double precision.
+ *
+ * Usage: csread_check_fast_math [stride]
+ *
+ * log() must be within 5e-7 absolute, exp() within 2e-7 relative, on top of
+ * rounding the result: half a unit in the last place of the float result.
+ * Prints the worst case for each, and returns 1 if a bound is exceeded.
+ * Takes a few minutes. With a stride, only every stride-th float is checked,
+ * which is quick enough to run as a test; an odd stride samples all mantissa
+ * bits.
+ */
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "../csread/table/math_policy.h"
+
+namespace
+{
+	// Half a unit in the last place of a float result
+	double half_ulp(float y)
+	{
+		const float a = std::fabs(y);
+		return 0.5 * (static_cast<double>(std::nextafter(a, FLT_MAX)) - a);
+	}
+
+	// Error closest to, or furthest over, the allowed error
+	struct worst_t
+	{
+		double excess; // Error minus the allowed error, in units of the bound
+		double error;
+		double allowed;
+		float x;
+	};
+
+	template<typename check_func>
+	worst_t sweep(uint32_t stride, check_func check)
+	{
+		worst_t worst = { -1, 0, 0, 0 };
+		for (uint32_t sign = 0; sign < 2; ++sign)
+		{
+			// All normal floats of this sign
+			const uint32_t first = (sign << 31) | 0x00800000;
+			const uint32_t last = (sign << 31) | 0x7f7fffff;
+			for (uint32_t bits = first; ; bits += stride)
+			{
+				float x;
+				std::memcpy(&x, &bits, sizeof(x));
+				check(x, worst);
+				if (last - bits < stride)
+					break;
+			}
+		}
+		return worst;
+	}
+
+	void update(worst_t & worst, float x, double error, double allowed, double bound)
+	{
+		const double excess = (error - allowed) / bound;
+		if (!(excess <= worst.excess))
+			worst = { excess, error, allowed, x };
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const long stride = (argc > 1 ? std::strtol(argv[1], nullptr, 10) : 1);
+	if (stride < 1 || stride > 0x7fffff)
+	{
+		std::cerr << "Usage: csread_check_fast_math [stride]\n";
+		return 2;
+	}
+
+	const double log_bound = 5e-7;
+	const double exp_bound = 2e-7;
+
+	// Absolute error of log(), for positive x; negative x goes to std::log.
+	const worst_t log_worst = sweep(static_cast<uint32_t>(stride), [log_bound](float x, worst_t & worst)
+	{
+		if (x < 0)
+			return;
+		const float y = fast_math::log(x);
+		const double error = std::fabs(y - std::log(static_cast<double>(x)));
+		update(worst, x, error, log_bound + half_ulp(y), log_bound);
+	});
+
+	// Relative error of exp(), where the result is a normal float
+	const worst_t exp_worst = sweep(static_cast<uint32_t>(stride), [exp_bound](float x, worst_t & worst)
+	{
+		const double reference = std::exp(static_cast<double>(x));
+		if (!(reference >= FLT_MIN && reference <= FLT_MAX))
+			return;
+		const float y = fast_math::exp(x);
+		const double error = std::fabs(y - reference) / reference;
+		update(worst, x, error, exp_bound + half_ulp(y) / reference, exp_bound);
+	});
+
+	std::cout.precision(9);
+	std::cout << "log: absolute error " << log_worst.error << ", allowed " << log_worst.allowed
+		<< ", at x = " << log_worst.x << '\n';
+	std::cout << "exp: relative error " << exp_worst.error << ", allowed " << exp_worst.allowed
+		<< ", at x = " << exp_worst.x << '\n';
+
+	bool ok = true;
+	if (log_worst.excess > 0)
+	{
+		std::cerr << "fast_math::log exceeds its error bound of " << log_bound << '\n';
+		ok = false;
+	}
+	if (exp_worst.excess > 0)
+	{
+		std::cerr << "fast_math::exp exceeds its error bound of " << exp_bound << '\n';
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
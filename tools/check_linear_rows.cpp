@@ -0,0 +1,100 @@
+/*
+ * Check that linear_rows (csread/table/linear_rows.h), used to build the
+ * fast ICDF tables, gives the same values as array2D_ax::at_linear_index,
+ * bit for bit, including positions outside the table.
+ *
+ * Usage: csread_check_linear_rows
+ *
+ * Returns 1 and prints the first difference if there is one.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../csread/table/array2D_ax.h"
+#include "../csread/table/ax_linspace.h"
+#include "../csread/table/ax_list.h"
+#include "../csread/table/linear_rows.h"
+
+namespace
+{
+	// Deterministic pseudo-random numbers in [0, 1)
+	struct lcg
+	{
+		uint64_t state = 12345;
+		double operator()()
+		{
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			return (state >> 11) * (1.0 / 9007199254740992.0);
+		}
+	};
+
+	template<typename real>
+	using table_t = array2D_ax<real, ax_list<real>, ax_linspace<real>>;
+
+	// An uneven energy axis and random values, like an intern ICDF table.
+	template<typename real>
+	table_t<real> make_table(size_t N_x, size_t N_y, lcg & random)
+	{
+		std::vector<real> x(N_x);
+		real position = 1;
+		for (size_t i = 0; i < N_x; ++i)
+		{
+			position += static_cast<real>(0.1 + random());
+			x[i] = position;
+		}
+		std::vector<real> values(N_x * N_y);
+		for (real & value : values)
+			value = static_cast<real>(random() * 100 - 10);
+		return table_t<real>(ax_list<real>(x), ax_linspace<real>(0, 1, N_y), values);
+	}
+
+	template<typename real, typename out_t>
+	bool check(size_t N_x, size_t N_y, size_t N_P, lcg & random)
+	{
+		const table_t<real> table = make_table<real>(N_x, N_y, random);
+
+		// Columns on the unit interval, plus some outside it
+		std::vector<real> true_y;
+		for (size_t ip = 0; ip < N_P; ++ip)
+			true_y.push_back(table.find_y(static_cast<real>(ip) / (N_P - 1)));
+		for (real y : { real(-0.3), real(1.2), real(-1e-7), real(1 + 1e-7) })
+			true_y.push_back(table.find_y(y));
+
+		const linear_rows<table_t<real>> rows(table, true_y);
+		std::vector<out_t> row(true_y.size());
+		for (size_t ix = 0; ix < 4 * N_x; ++ix)
+		{
+			// Between all grid points, and beyond both ends
+			const real true_x = static_cast<real>(ix) / 4 - 1 + static_cast<real>(random() * 0.25);
+			rows.fill_row(true_x, row.data());
+			for (size_t iy = 0; iy < true_y.size(); ++iy)
+			{
+				const out_t expected = static_cast<out_t>(table.at_linear_index(true_x, true_y[iy]));
+				if (std::memcmp(&expected, &row[iy], sizeof(out_t)) != 0)
+				{
+					std::cerr << "Difference at true index (" << true_x << ", " << true_y[iy] << "): "
+						<< row[iy] << " instead of " << expected << '\n';
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	lcg random;
+	bool ok = true;
+	ok &= check<double, float>(100, 50, 33, random);
+	ok &= check<double, double>(100, 50, 33, random);
+	ok &= check<float, float>(100, 50, 33, random);
+	ok &= check<double, float>(2, 2, 2, random);
+	ok &= check<double, float>(37, 101, 1024, random);
+	if (ok)
+		std::cout << "linear_rows equals array2D_ax::at_linear_index\n";
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+/*
+ * Convert a material file generated by cstool (HDF5) to csread's binary format.
+ *
+ * Usage: csread_h5_to_binary input.hdf5 output.bin [K_min K_max N_K N_P]
+ *
+ * If an energy range (in eV) and grid sizes are given, all fast tables are built
+ * for these parameters and stored as well. IMFP and range tables use N_K points.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include "../csread/material.h"
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3 && argc != 7)
+	{
+		std::cerr << "Usage: " << argv[0] << " input.hdf5 output.bin [K_min K_max N_K N_P]\n";
+		return 1;
+	}
+
+	try
+	{
+		material mat(argv[1]);
+
+		std::vector<material::fast_table_spec> fast_tables;
+		if (argc == 7)
+		{
+			const material::fast_real K_min = std::strtof(argv[3], nullptr);
+			const material::fast_real K_max = std::strtof(argv[4], nullptr);
+			const size_t N_K = std::strtoul(argv[5], nullptr, 10);
+			const size_t N_P = std::strtoul(argv[6], nullptr, 10);
+			if (!(K_min > 0 && K_max > K_min && N_K > 1 && N_P > 1))
+				throw std::runtime_error("Invalid energy range or grid size.");
+
+			for (material::table_kind_t kind : {
+				material::TBL_ELASTIC_IMFP,
+				material::TBL_ELASTIC_ANGLE_ICDF,
+				material::TBL_INELASTIC_IMFP,
+				material::TBL_INELASTIC_W0_ICDF,
+				material::TBL_IONIZATION_ICDF,
+				material::TBL_ELECTRON_RANGE })
+			{
+				fast_tables.push_back({ kind, K_min, K_max, N_K, N_P });
+			}
+		}
+
+		mat.save_binary(argv[2], fast_tables);
+	}
+	catch (std::exception const & error)
+	{
+		std::cerr << "Error: " << error.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+}